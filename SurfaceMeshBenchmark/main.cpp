@@ -0,0 +1,463 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "MeshDefinition.h"
+#include "MeshAdjacency.h"
+#include "MeshBuilder.h"
+#include "MeshClusters.h"
+#include "MeshHistory.h"
+#include "MeshProxy.h"
+#include "MeshGenerator.h"
+#include "MeshStats.h"
+#include "MeshCompactor.h"
+#include "MeshReorder.h"
+#include "VertexCache.h"
+#include "ThreadPool.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+// Times the MeshTools hot paths on generated meshes of growing size. Every
+//   result is one line of JSON on stdout with a fixed set of keys, so the
+//   output of two commits can be compared line by line; with --baseline the
+//   comparison is done here and slower results make the exit code non-zero.
+//   The log output of MeshTools goes to stderr.
+
+namespace
+{
+	const char* usage =
+		"Usage: SurfaceMeshBenchmark [options]\n"
+		"Options:\n"
+		"  --sizes <list>       comma separated face counts (default: 1000,10000,100000,1000000,10000000,50000000)\n"
+		"  --ops <list>         comma separated benchmarks (default: all)\n"
+		"  --repeat <n>         runs per benchmark; the median is reported (default: 3)\n"
+		"  --tmpdir <dir>       directory for the OBJ files (default: system temp)\n"
+		"  --label <text>       copied into every result, e.g. a commit id\n"
+		"  --baseline <file>    earlier output to compare against\n"
+		"  --tolerance <x>      allowed slowdown against the baseline (default: 0.1)\n"
+		"  -h, --help           show this message\n";
+
+	const char* allops[] = { "WriteOBJ", "WriteOBJFast", "ReadOBJ", "ReadOBJMapped", "ReadOBJParallel",
+		"Area", "AreaSerial", "AverageEdgeLength", "AverageEdgeLengthSerial", "HasBoundary", "HasOneComponent", "Genus",
+		"BoundingBox", "BoundingBoxSerial", "MeshStats", "AdjacencyBuild", "AdjacencyArea", "AdjacencyComponents", "ClusterBuild", "ClusterCull", "Reassign", "Compact", "ReorderMorton", "ReorderHilbert", "ReorderRCM", "VertexCache", "HistoryCommit", "ProxyCluster", "BuildQuads", "update_normals" };
+
+	struct Options
+	{
+		std::vector<long long> sizes = { 1000, 10000, 100000, 1000000, 10000000, 50000000 };
+		std::vector<std::string> ops;
+		int repeat = 3;
+		std::string tmpdir;
+		std::string label;
+		std::string baseline;
+		double tolerance = 0.1;
+	};
+
+	struct Result
+	{
+		std::string op;
+		long long faces = 0;
+		size_t vertices = 0;
+		double median = 0.0;
+		double min = 0.0;
+		size_t bytes = 0;
+		size_t peakmemory = 0;
+	};
+
+	std::vector<std::string> Split(const std::string & s, char sep)
+	{
+		std::vector<std::string> parts;
+		std::stringstream ss(s);
+		std::string part;
+		while (std::getline(ss, part, sep))
+		{
+			if (!part.empty()) parts.push_back(part);
+		}
+		return parts;
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options & options)
+	{
+		options.ops.assign(std::begin(allops), std::end(allops));
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			bool hasvalue = i + 1 < argc;
+			if (arg == "--sizes" && hasvalue)
+			{
+				options.sizes.clear();
+				for (const auto & s : Split(argv[++i], ','))
+				{
+					options.sizes.push_back(std::atoll(s.c_str()));
+				}
+			}
+			else if (arg == "--ops" && hasvalue)
+			{
+				options.ops = Split(argv[++i], ',');
+			}
+			else if (arg == "--repeat" && hasvalue)
+			{
+				options.repeat = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (arg == "--tmpdir" && hasvalue)
+			{
+				options.tmpdir = argv[++i];
+			}
+			else if (arg == "--label" && hasvalue)
+			{
+				options.label = argv[++i];
+			}
+			else if (arg == "--baseline" && hasvalue)
+			{
+				options.baseline = argv[++i];
+			}
+			else if (arg == "--tolerance" && hasvalue)
+			{
+				options.tolerance = std::atof(argv[++i]);
+			}
+			else
+			{
+				if (arg != "-h" && arg != "--help") std::cerr << "Error: unknown option " << arg << std::endl;
+				return false;
+			}
+		}
+		for (const auto & op : options.ops)
+		{
+			if (std::find(std::begin(allops), std::end(allops), op) == std::end(allops))
+			{
+				std::cerr << "Error: unknown benchmark " << op << std::endl;
+				return false;
+			}
+		}
+		if (options.tmpdir.empty())
+		{
+			options.tmpdir = std::filesystem::temp_directory_path().string();
+		}
+		return true;
+	}
+
+	// Peak resident memory of the process in bytes. On Linux the peak is reset
+	//   by ResetPeakMemory, so it covers a single benchmark; elsewhere it is the
+	//   peak since the process started.
+	void ResetPeakMemory(void)
+	{
+#ifdef __linux__
+		std::ofstream ofs("/proc/self/clear_refs");
+		ofs << "5";
+#endif
+	}
+
+	size_t PeakMemory(void)
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		{
+			return pmc.PeakWorkingSetSize;
+		}
+#elif defined(__linux__)
+		std::ifstream ifs("/proc/self/status");
+		std::string line;
+		while (std::getline(ifs, line))
+		{
+			if (line.compare(0, 6, "VmHWM:") == 0)
+			{
+				return static_cast<size_t>(std::atoll(line.c_str() + 6)) * 1024;
+			}
+		}
+#endif
+		return 0;
+	}
+
+	std::string JsonString(const std::string & s)
+	{
+		std::string out = "\"";
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\') out += '\\';
+			out += c;
+		}
+		return out + "\"";
+	}
+
+	std::string ToJson(const Options & options, const Result & r)
+	{
+		std::ostringstream oss;
+		oss << std::setprecision(6);
+		double throughput = r.median > 0.0 ? r.faces / r.median : 0.0;
+		oss << "{\"label\":" << JsonString(options.label)
+			<< ",\"op\":" << JsonString(r.op)
+			<< ",\"faces\":" << r.faces
+			<< ",\"vertices\":" << r.vertices
+			<< ",\"threads\":" << ThreadPool::Global().Size()
+			<< ",\"repeat\":" << options.repeat
+			<< ",\"median\":" << r.median
+			<< ",\"min\":" << r.min
+			<< ",\"facespersecond\":" << throughput
+			<< ",\"bytes\":" << r.bytes
+			<< ",\"megabytespersecond\":" << (r.median > 0.0 ? r.bytes / r.median / 1.0e6 : 0.0)
+			<< ",\"peakmemory\":" << r.peakmemory
+			<< "}";
+		return oss.str();
+	}
+
+	// the value of "key": in a line written by ToJson
+	std::string JsonValue(const std::string & line, const std::string & key)
+	{
+		std::string pattern = "\"" + key + "\":";
+		auto pos = line.find(pattern);
+		if (pos == std::string::npos) return std::string();
+		pos += pattern.size();
+		auto end = line[pos] == '"' ? line.find('"', pos + 1) + 1 : line.find_first_of(",}", pos);
+		std::string value = line.substr(pos, end - pos);
+		if (!value.empty() && value.front() == '"') value = value.substr(1, value.size() - 2);
+		return value;
+	}
+
+	// median times of an earlier run by (op, faces)
+	typedef std::map<std::pair<std::string, long long>, double> Baseline;
+
+	Baseline ReadBaseline(const std::string & filename)
+	{
+		Baseline baseline;
+		std::ifstream ifs(filename);
+		if (!ifs.is_open())
+		{
+			std::cerr << "Error: cannot open file " << filename << std::endl;
+			return baseline;
+		}
+		std::string line;
+		while (std::getline(ifs, line))
+		{
+			std::string op = JsonValue(line, "op");
+			if (op.empty()) continue;
+			baseline[{ op, std::atoll(JsonValue(line, "faces").c_str()) }] = std::atof(JsonValue(line, "median").c_str());
+		}
+		return baseline;
+	}
+
+	Result Run(const Options & options, const std::string & op, long long faces, const Mesh & mesh,
+		const std::function<void(void)> & setup, const std::function<void(void)> & task)
+	{
+		Result r;
+		r.op = op;
+		r.faces = faces;
+		r.vertices = mesh.n_vertices();
+		std::vector<double> times;
+		ResetPeakMemory();
+		for (int i = 0; i < options.repeat; ++i)
+		{
+			if (setup) setup();
+			auto start = std::chrono::steady_clock::now();
+			task();
+			times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		r.peakmemory = PeakMemory();
+		std::sort(times.begin(), times.end());
+		r.median = times[times.size() / 2];
+		r.min = times.front();
+		return r;
+	}
+
+	size_t FileSize(const std::string & filename)
+	{
+		std::error_code ec;
+		auto size = std::filesystem::file_size(filename, ec);
+		return ec ? 0 : static_cast<size_t>(size);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cerr << usage;
+		return 2;
+	}
+	Baseline baseline;
+	if (!options.baseline.empty())
+	{
+		baseline = ReadBaseline(options.baseline);
+	}
+	// MeshTools reports to std::cout; keep stdout for the results
+	std::ostream out(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+	auto wanted = [&](const std::string & op) { return std::find(options.ops.begin(), options.ops.end(), op) != options.ops.end(); };
+	int nslower = 0;
+	for (long long faces : options.sizes)
+	{
+		Mesh mesh;
+		MeshGenerator::Torus(mesh, faces);
+		std::cerr << "Benchmarking " << mesh.n_faces() << " faces" << std::endl;
+		std::string objfile = (std::filesystem::path(options.tmpdir) / ("SurfaceMeshBenchmark_" + std::to_string(faces) + ".obj")).string();
+		std::vector<Result> results;
+		auto bench = [&](const std::string & op, const std::function<void(void)> & task, const std::function<void(void)> & setup = nullptr)
+		{
+			if (!wanted(op)) return;
+			results.push_back(Run(options, op, faces, mesh, setup, task));
+		};
+		bench("WriteOBJ", [&] { MeshTools::WriteOBJ(mesh, objfile); });
+		bench("WriteOBJFast", [&] { MeshTools::WriteOBJFast(mesh, objfile); });
+		for (auto & r : results) r.bytes = FileSize(objfile);
+		for (const char* op : { "ReadOBJ", "ReadOBJMapped", "ReadOBJParallel" })
+		{
+			if (!wanted(op)) continue;
+			if (!std::filesystem::exists(objfile))
+			{
+				MeshTools::WriteOBJFast(mesh, objfile);
+			}
+			Mesh read;
+			auto clear = [&] { read.clear(); };
+			std::string name(op);
+			if (name == "ReadOBJ") bench(op, [&] { MeshTools::ReadOBJ(read, objfile); }, clear);
+			else if (name == "ReadOBJMapped") bench(op, [&] { MeshTools::ReadOBJMapped(read, objfile); }, clear);
+			else bench(op, [&] { MeshTools::ReadOBJParallel(read, objfile); }, clear);
+			results.back().bytes = FileSize(objfile);
+		}
+		std::error_code ec;
+		std::filesystem::remove(objfile, ec);
+		double sink = 0.0;
+		bench("Area", [&] { sink += MeshTools::Area(mesh); });
+		bench("AreaSerial", [&] { sink += MeshTools::Area(mesh, false); });
+		bench("AverageEdgeLength", [&] { sink += MeshTools::AverageEdgeLength(mesh); });
+		bench("AverageEdgeLengthSerial", [&] { sink += MeshTools::AverageEdgeLength(mesh, false); });
+		bench("HasBoundary", [&] { sink += MeshTools::HasBoundary(mesh); });
+		bench("HasOneComponent", [&] { sink += MeshTools::HasOneComponent(mesh); });
+		bench("Genus", [&] { sink += MeshTools::Genus(mesh); });
+		for (bool parallel : { true, false })
+		{
+			bench(parallel ? "BoundingBox" : "BoundingBoxSerial", [&]
+			{
+				Mesh::Point bmax, bmin;
+				MeshTools::BoundingBox(mesh, bmax, bmin, parallel);
+				sink += bmax[0] - bmin[0];
+			});
+		}
+		bench("MeshStats", [&]
+		{
+			MeshStats::Values values;
+			MeshStats::Compute(mesh, values);
+			sink += values.genus;
+		});
+		{
+			MeshAdjacency adjacency;
+			bench("AdjacencyBuild", [&] { adjacency.Build(mesh); }, [&] { adjacency.Clear(); });
+			adjacency.Build(mesh);
+			bench("AdjacencyArea", [&] { sink += adjacency.Area(mesh.points()); });
+			std::vector<int> facecomponent;
+			bench("AdjacencyComponents", [&] { sink += adjacency.Components(facecomponent); });
+		}
+		{
+			MeshClusters clusters;
+			bench("ClusterBuild", [&] { clusters.Build(mesh); }, [&] { clusters.Clear(); });
+			clusters.Build(mesh);
+			// from three radii in front of the center with a 45 degree frustum,
+			//   so that about half of the clusters face away
+			Mesh::Point bmax, bmin;
+			MeshTools::BoundingBox(mesh, bmax, bmin);
+			const Mesh::Point center = (bmax + bmin) * Mesh::Scalar(0.5);
+			const double radius = (bmax - bmin).norm() * 0.5;
+			const double modelview[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0,
+				-center[0], -center[1], -center[2] - 3.0 * radius, 1 };
+			const double znear = 0.01 * radius, zfar = 100.0 * radius, f = 1.0 / std::tan(std::atan(1.0) / 2.0);
+			const double projection[16] = { f, 0, 0, 0, 0, f, 0, 0,
+				0, 0, (zfar + znear) / (znear - zfar), -1, 0, 0, 2.0 * zfar * znear / (znear - zfar), 0 };
+			std::vector<std::pair<int, int>> ranges;
+			MeshClusters::CullStats cullstats;
+			bench("ClusterCull", [&] { clusters.Cull(modelview, projection, true, ranges, cullstats); });
+			sink += static_cast<double>(cullstats.ndrawntriangles);
+		}
+		{
+			Mesh reassigned;
+			bench("Reassign", [&] { MeshTools::Reassign(mesh, reassigned); }, [&] { reassigned.clear(); });
+		}
+		// renumbers nothing on a freshly built mesh, so every run does the same work
+		bench("Compact", [&] { MeshCompactor::Compact(mesh); });
+		// on a copy, so that every run starts from the generated order
+		for (auto order : { MeshReorder::ORDER_MORTON, MeshReorder::ORDER_HILBERT, MeshReorder::ORDER_RCM })
+		{
+			const char* name = order == MeshReorder::ORDER_MORTON ? "ReorderMorton" : order == MeshReorder::ORDER_HILBERT ? "ReorderHilbert" : "ReorderRCM";
+			Mesh reordered;
+			bench(name, [&] { MeshReorder::Reorder(reordered, order); }, [&] { reordered = mesh; });
+		}
+		{
+			std::vector<unsigned int> faceorder, indices;
+			faceorder.reserve(3 * mesh.n_faces());
+			for (const auto & fh : mesh.faces())
+			{
+				for (const auto & fvh : mesh.fv_range(fh)) faceorder.push_back(fvh.idx());
+			}
+			bench("VertexCache", [&] { VertexCache::Optimize(indices, static_cast<int>(mesh.n_vertices())); }, [&] { indices = faceorder; });
+		}
+		{
+			// against an identical state, so every chunk is compared and shared
+			MeshHistory history;
+			bench("HistoryCommit", [&] { history.Commit(mesh); }, [&] { history.Clear(); history.Commit(mesh); });
+		}
+		{
+			// the viewer's default budget of 1M triangles, or a hundredth of the mesh
+			std::vector<float> proxypoints;
+			std::vector<unsigned int> proxytriangles;
+			const int target = std::min(1 << 20, std::max(1000, static_cast<int>(mesh.n_faces() / 100)));
+			bench("ProxyCluster", [&] { MeshProxy::Cluster(mesh, target, proxypoints, proxytriangles); });
+			sink += static_cast<double>(proxytriangles.size());
+		}
+		if (wanted("BuildQuads"))
+		{
+			// the grid's triangles come in pairs (v0, v1, v2), (v0, v2, v3),
+			//   the fan of the quad (v0, v1, v2, v3)
+			Mesh grid, quads;
+			MeshGenerator::Grid(grid, faces);
+			std::vector<Mesh::Point> points(grid.points(), grid.points() + grid.n_vertices());
+			std::vector<int> faceindices, faceoffsets(1, 0);
+			for (int f = 0; f + 1 < static_cast<int>(grid.n_faces()); f += 2)
+			{
+				for (const auto & fvh : grid.fv_range(Mesh::FaceHandle(f)))
+				{
+					faceindices.push_back(fvh.idx());
+				}
+				int v0 = faceindices[faceindices.size() - 3], v2 = faceindices.back();
+				for (const auto & fvh : grid.fv_range(Mesh::FaceHandle(f + 1)))
+				{
+					if (fvh.idx() != v0 && fvh.idx() != v2) faceindices.push_back(fvh.idx());
+				}
+				faceoffsets.push_back(static_cast<int>(faceindices.size()));
+			}
+			bench("BuildQuads", [&] { MeshBuilder::Build(quads, points, faceindices, faceoffsets); }, [&] { quads.clear(); });
+		}
+		bench("update_normals", [&] { mesh.update_normals(); });
+		std::cerr << "  (checksum " << sink << ")" << std::endl;
+		for (const auto & r : results)
+		{
+			out << ToJson(options, r) << std::endl;
+			auto it = baseline.find({ r.op, r.faces });
+			if (it != baseline.end() && r.median > it->second * (1.0 + options.tolerance))
+			{
+				++nslower;
+				std::cerr << "  Warning! " << r.op << " on " << r.faces << " faces took " << r.median
+					<< " s, baseline " << it->second << " s" << std::endl;
+			}
+		}
+	}
+	std::cout.rdbuf(out.rdbuf());
+	return nslower == 0 ? 0 : 1;
+}
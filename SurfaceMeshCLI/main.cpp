@@ -0,0 +1,447 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "MeshDefinition.h"
+#include "MeshAdjacency.h"
+#include "MeshGenerator.h"
+#include "MeshStats.h"
+#include "MeshComponents.h"
+#include "MeshReorder.h"
+#include "VertexCache.h"
+
+// Batch front end for MeshTools without Qt or OpenGL. Every input mesh is read,
+//   the requested operations are run in order, and one line of JSON with the
+//   timings and results is printed to stdout per mesh. The log output of
+//   MeshTools goes to stderr so that stdout stays machine-readable. An input
+//   named gen:<kind>:<faces>[:<seed>] is generated by MeshGenerator instead.
+
+namespace
+{
+	const char* usage =
+		"Usage: SurfaceMeshCLI [options] <mesh> [<mesh> ...]\n"
+		"  <mesh> is a file or gen:<kind>:<faces>[:<seed>] with <kind> one of\n"
+		"  icosphere, torus, grid, holes<n> (genus n) or scene<n> (n components)\n"
+		"Options:\n"
+		"  --ops <list>      comma separated operations, run in order (default: analysis)\n"
+		"                    analysis: area, edgelength, boundary, components, genus, bbox\n"
+		"                    stats: all of the above and more in one pass\n"
+		"                    pieces: size, boundary loops and genus of every component\n"
+		"                    adjacency: area, boundary edges and components on a MeshAdjacency\n"
+		"                    processing: normals, reassign\n"
+		"                    reordering: morton, hilbert, rcm (see MeshReorder)\n"
+		"                    vcache: vertex cache misses before and after VertexCache::Optimize\n"
+		"  --reader <name>   OBJ reader: stream, mapped or parallel (default: parallel)\n"
+		"  --cache           read and write .smc caches next to the inputs\n"
+		"  --serial          run area, edgelength, bbox, stats and pieces on one thread\n"
+		"  -o <file>         write the result mesh (single input only)\n"
+		"  --outdir <dir>    write each result mesh to <dir>/<name>.<ext>\n"
+		"  --ext <ext>       file extension used with --outdir (default: obj)\n"
+		"  --precision <n>   digits of the written coordinates (default: 17)\n"
+		"  -h, --help        show this message\n";
+
+	struct Options
+	{
+		std::vector<std::string> inputs;
+		std::vector<std::string> ops;
+		MeshTools::OBJReader reader = MeshTools::OBJ_PARALLEL;
+		bool usecache = false;
+		bool parallel = true;
+		std::string output;
+		std::string outdir;
+		std::string ext = "obj";
+		int precision = 17;
+	};
+
+	std::vector<std::string> Split(const std::string & s, char sep)
+	{
+		std::vector<std::string> parts;
+		std::stringstream ss(s);
+		std::string part;
+		while (std::getline(ss, part, sep))
+		{
+			if (!part.empty()) parts.push_back(part);
+		}
+		return parts;
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options & options)
+	{
+		options.ops = { "area", "edgelength", "boundary", "components", "genus", "bbox" };
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			bool hasvalue = i + 1 < argc;
+			if (arg == "-h" || arg == "--help")
+			{
+				return false;
+			}
+			else if (arg == "--ops" && hasvalue)
+			{
+				options.ops = Split(argv[++i], ',');
+			}
+			else if (arg == "--reader" && hasvalue)
+			{
+				std::string name = argv[++i];
+				if (name == "stream") options.reader = MeshTools::OBJ_STREAM;
+				else if (name == "mapped") options.reader = MeshTools::OBJ_MAPPED;
+				else if (name == "parallel") options.reader = MeshTools::OBJ_PARALLEL;
+				else
+				{
+					std::cerr << "Error: unknown reader " << name << std::endl;
+					return false;
+				}
+			}
+			else if (arg == "--cache")
+			{
+				options.usecache = true;
+			}
+			else if (arg == "--serial")
+			{
+				options.parallel = false;
+			}
+			else if (arg == "-o" && hasvalue)
+			{
+				options.output = argv[++i];
+			}
+			else if (arg == "--outdir" && hasvalue)
+			{
+				options.outdir = argv[++i];
+			}
+			else if (arg == "--ext" && hasvalue)
+			{
+				options.ext = argv[++i];
+			}
+			else if (arg == "--precision" && hasvalue)
+			{
+				options.precision = std::atoi(argv[++i]);
+			}
+			else if (!arg.empty() && arg[0] == '-')
+			{
+				std::cerr << "Error: unknown option " << arg << std::endl;
+				return false;
+			}
+			else
+			{
+				options.inputs.push_back(arg);
+			}
+		}
+		const char* known[] = { "area", "edgelength", "boundary", "components", "genus", "bbox", "stats", "pieces", "adjacency", "normals", "reassign", "morton", "hilbert", "rcm", "vcache" };
+		for (const auto & op : options.ops)
+		{
+			if (std::find(std::begin(known), std::end(known), op) == std::end(known))
+			{
+				std::cerr << "Error: unknown operation " << op << std::endl;
+				return false;
+			}
+		}
+		if (options.inputs.empty())
+		{
+			std::cerr << "Error: no input mesh" << std::endl;
+			return false;
+		}
+		if (!options.output.empty() && options.inputs.size() > 1)
+		{
+			std::cerr << "Error: -o needs a single input; use --outdir" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::string JsonString(const std::string & s)
+	{
+		std::ostringstream oss;
+		oss << '"';
+		for (unsigned char c : s)
+		{
+			switch (c)
+			{
+			case '"': oss << "\\\""; break;
+			case '\\': oss << "\\\\"; break;
+			case '\n': oss << "\\n"; break;
+			case '\r': oss << "\\r"; break;
+			case '\t': oss << "\\t"; break;
+			default:
+				if (c < 0x20) oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+				else oss << c;
+				break;
+			}
+		}
+		oss << '"';
+		return oss.str();
+	}
+
+	std::string JsonNumber(double x)
+	{
+		// JSON has no inf or nan
+		if (!std::isfinite(x)) return "null";
+		std::ostringstream oss;
+		oss << std::setprecision(std::numeric_limits<double>::max_digits10) << x;
+		return oss.str();
+	}
+
+	std::string JsonPoint(const Mesh::Point & p)
+	{
+		return "[" + JsonNumber(p[0]) + "," + JsonNumber(p[1]) + "," + JsonNumber(p[2]) + "]";
+	}
+
+	// "key":value pairs in insertion order
+	class JsonObject
+	{
+	public:
+		void Add(const std::string & key, const std::string & value)
+		{
+			text += (text.empty() ? "" : ",") + JsonString(key) + ":" + value;
+		}
+		std::string Str(void) const
+		{
+			return "{" + text + "}";
+		}
+	private:
+		std::string text;
+	};
+
+	template <typename Task>
+	double Time(const Task & task)
+	{
+		auto start = std::chrono::steady_clock::now();
+		task();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// gen:<kind>:<faces>[:<seed>]
+	bool Generate(Mesh & mesh, const std::string & input)
+	{
+		std::vector<std::string> parts = Split(input, ':');
+		if (parts.size() < 3 || parts.size() > 4) return false;
+		const std::string & kind = parts[1];
+		long long faces = std::atoll(parts[2].c_str());
+		unsigned int seed = parts.size() == 4 ? static_cast<unsigned int>(std::strtoul(parts[3].c_str(), nullptr, 10)) : 0;
+		if (faces <= 0) return false;
+		auto count = [&](const std::string & prefix) { return std::atoi(kind.c_str() + prefix.size()); };
+		if (kind == "icosphere") MeshGenerator::Icosphere(mesh, faces, seed);
+		else if (kind == "torus") MeshGenerator::Torus(mesh, faces, seed);
+		else if (kind == "grid") MeshGenerator::Grid(mesh, faces, seed);
+		else if (kind.compare(0, 5, "holes") == 0) MeshGenerator::HoleSurface(mesh, count("holes"), faces, seed);
+		else if (kind.compare(0, 5, "scene") == 0) MeshGenerator::Scene(mesh, count("scene"), faces, seed);
+		else return false;
+		return true;
+	}
+
+	std::string OutputName(const Options & options, const std::string & input)
+	{
+		if (!options.output.empty()) return options.output;
+		if (options.outdir.empty()) return std::string();
+		std::string file = input;
+		if (file.compare(0, 4, "gen:") == 0) std::replace(file.begin(), file.end(), ':', '_');
+		std::filesystem::path name = std::filesystem::path(file).filename();
+		name.replace_extension(options.ext);
+		return (std::filesystem::path(options.outdir) / name).string();
+	}
+
+	bool Process(const Options & options, const std::string & input, std::string & json)
+	{
+		JsonObject result, timings, stats;
+		result.Add("file", JsonString(input));
+		Mesh mesh;
+		bool read_OK = false;
+		if (input.compare(0, 4, "gen:") == 0)
+		{
+			timings.Add("generate", JsonNumber(Time([&] { read_OK = Generate(mesh, input); })));
+		}
+		else
+		{
+			timings.Add("read", JsonNumber(Time([&] { read_OK = MeshTools::ReadMesh(mesh, input, options.reader, options.usecache); })));
+		}
+		if (!read_OK)
+		{
+			result.Add("ok", "false");
+			result.Add("error", JsonString("cannot read mesh"));
+			result.Add("timings", timings.Str());
+			json = result.Str();
+			return false;
+		}
+		for (const auto & op : options.ops)
+		{
+			double t = 0.0;
+			if (op == "area")
+			{
+				double area = 0.0;
+				t = Time([&] { area = MeshTools::Area(mesh, options.parallel); });
+				stats.Add(op, JsonNumber(area));
+			}
+			else if (op == "edgelength")
+			{
+				double len = 0.0;
+				t = Time([&] { len = MeshTools::AverageEdgeLength(mesh, options.parallel); });
+				stats.Add(op, JsonNumber(len));
+			}
+			else if (op == "boundary")
+			{
+				bool b = false;
+				t = Time([&] { b = MeshTools::HasBoundary(mesh); });
+				stats.Add(op, b ? "true" : "false");
+			}
+			else if (op == "components")
+			{
+				bool b = false;
+				t = Time([&] { b = MeshTools::HasOneComponent(mesh); });
+				stats.Add("onecomponent", b ? "true" : "false");
+			}
+			else if (op == "genus")
+			{
+				int genus = -1;
+				t = Time([&] { genus = MeshTools::Genus(mesh); });
+				stats.Add(op, std::to_string(genus));
+			}
+			else if (op == "bbox")
+			{
+				Mesh::Point bmax(0.0), bmin(0.0);
+				t = Time([&] { MeshTools::BoundingBox(mesh, bmax, bmin, options.parallel); });
+				stats.Add(op, "[" + JsonPoint(bmin) + "," + JsonPoint(bmax) + "]");
+			}
+			else if (op == "stats")
+			{
+				MeshStats::Values values;
+				t = Time([&] { MeshStats::Compute(mesh, values, options.parallel); });
+				JsonObject s;
+				s.Add("vertices", std::to_string(values.nvertices));
+				s.Add("edges", std::to_string(values.nedges));
+				s.Add("faces", std::to_string(values.nfaces));
+				s.Add("bbox", "[" + JsonPoint(values.bmin) + "," + JsonPoint(values.bmax) + "]");
+				s.Add("area", JsonNumber(values.area));
+				s.Add("minedgelength", JsonNumber(values.minedgelength));
+				s.Add("maxedgelength", JsonNumber(values.maxedgelength));
+				s.Add("edgelength", JsonNumber(values.avgedgelength));
+				s.Add("boundaryedges", std::to_string(values.nboundaryedges));
+				s.Add("boundaryloops", std::to_string(values.nboundaryloops));
+				s.Add("components", std::to_string(values.ncomponents));
+				s.Add("euler", std::to_string(values.euler));
+				s.Add("genus", std::to_string(values.genus));
+				stats.Add(op, s.Str());
+			}
+			else if (op == "pieces")
+			{
+				std::vector<MeshComponents::Component> components;
+				t = Time([&] { MeshComponents::Components(mesh, components, options.parallel); });
+				std::string list;
+				for (const auto & c : components)
+				{
+					JsonObject piece;
+					piece.Add("vertices", std::to_string(c.nvertices));
+					piece.Add("edges", std::to_string(c.nedges));
+					piece.Add("faces", std::to_string(c.nfaces));
+					piece.Add("boundaryloops", std::to_string(c.nboundaryloops));
+					piece.Add("euler", std::to_string(c.euler));
+					piece.Add("genus", std::to_string(c.genus));
+					list += (list.empty() ? "" : ",") + piece.Str();
+				}
+				stats.Add(op, "[" + list + "]");
+			}
+			else if (op == "adjacency")
+			{
+				// the time includes building the snapshot
+				MeshAdjacency adjacency;
+				double area = 0.0;
+				long long nboundary = 0;
+				int ncomponents = 0;
+				std::vector<int> facecomponent;
+				t = Time([&]
+				{
+					adjacency.Build(mesh, options.parallel);
+					area = adjacency.Area(mesh.points(), options.parallel);
+					nboundary = adjacency.BoundaryEdges();
+					ncomponents = adjacency.Components(facecomponent);
+				});
+				JsonObject a;
+				a.Add("area", JsonNumber(area));
+				a.Add("boundaryedges", std::to_string(nboundary));
+				a.Add("components", std::to_string(ncomponents));
+				stats.Add(op, a.Str());
+			}
+			else if (op == "normals")
+			{
+				t = Time([&] { mesh.update_normals(); });
+			}
+			else if (op == "reassign")
+			{
+				t = Time([&] { MeshTools::Reassign(mesh, mesh); });
+			}
+			else if (op == "morton" || op == "hilbert" || op == "rcm")
+			{
+				auto order = op == "morton" ? MeshReorder::ORDER_MORTON : op == "hilbert" ? MeshReorder::ORDER_HILBERT : MeshReorder::ORDER_RCM;
+				double before = MeshReorder::AverageEdgeSpan(mesh);
+				t = Time([&] { MeshReorder::Reorder(mesh, order); });
+				stats.Add(op + "span", "[" + JsonNumber(before) + "," + JsonNumber(MeshReorder::AverageEdgeSpan(mesh)) + "]");
+			}
+			else if (op == "vcache")
+			{
+				// the triangle list the viewer draws, before and after reordering
+				std::vector<unsigned int> indices;
+				indices.reserve(3 * mesh.n_faces());
+				for (const auto & fh : mesh.faces())
+				{
+					for (const auto & fvh : mesh.fv_range(fh)) indices.push_back(fvh.idx());
+				}
+				const int nv = static_cast<int>(mesh.n_vertices());
+				double acmr[2], atvr[2];
+				VertexCache::Measure(indices, nv, VertexCache::maxcachesize, acmr[0], atvr[0]);
+				t = Time([&] { VertexCache::Optimize(indices, nv); });
+				VertexCache::Measure(indices, nv, VertexCache::maxcachesize, acmr[1], atvr[1]);
+				stats.Add("acmr", "[" + JsonNumber(acmr[0]) + "," + JsonNumber(acmr[1]) + "]");
+				stats.Add("atvr", "[" + JsonNumber(atvr[0]) + "," + JsonNumber(atvr[1]) + "]");
+			}
+			timings.Add(op, JsonNumber(t));
+		}
+		std::string output = OutputName(options, input);
+		bool write_OK = true;
+		if (!output.empty())
+		{
+			timings.Add("write", JsonNumber(Time([&] { write_OK = MeshTools::WriteMesh(mesh, output, options.precision); })));
+			result.Add("output", JsonString(output));
+		}
+		result.Add("ok", write_OK ? "true" : "false");
+		if (!write_OK) result.Add("error", JsonString("cannot write mesh"));
+		result.Add("vertices", std::to_string(mesh.n_vertices()));
+		result.Add("edges", std::to_string(mesh.n_edges()));
+		result.Add("faces", std::to_string(mesh.n_faces()));
+		result.Add("timings", timings.Str());
+		result.Add("stats", stats.Str());
+		json = result.Str();
+		return write_OK;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cerr << usage;
+		return 2;
+	}
+	if (!options.outdir.empty())
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(options.outdir, ec);
+	}
+	// MeshTools reports to std::cout; keep stdout for the JSON lines
+	std::ostream json(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+	int nfailed = 0;
+	for (const auto & input : options.inputs)
+	{
+		std::string line;
+		if (!Process(options, input, line)) ++nfailed;
+		json << line << std::endl;
+	}
+	std::cout.rdbuf(json.rdbuf());
+	return nfailed == 0 ? 0 : 1;
+}
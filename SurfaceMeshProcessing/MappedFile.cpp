@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(void)
+	: data(nullptr),
+	size(0),
+	isopen(false),
+#ifdef _WIN32
+	file(INVALID_HANDLE_VALUE),
+	mapping(nullptr)
+#else
+	fd(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string & filename)
+{
+	Close();
+#ifdef _WIN32
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx(file, &filesize))
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(filesize.QuadPart);
+	if (size > 0)
+	{
+		// an empty file cannot be mapped, it is reported as open with no data
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			Close();
+			return false;
+		}
+		data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (data == nullptr)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(st.st_size);
+	if (size > 0)
+	{
+		void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+		madvise(addr, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(addr);
+	}
+#endif
+	isopen = true;
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data) munmap(const_cast<char*>(data), size);
+	if (fd >= 0) ::close(fd);
+	fd = -1;
+#endif
+	data = nullptr;
+	size = 0;
+	isopen = false;
+}
+
+bool MappedFile::IsOpen(void) const
+{
+	return isopen;
+}
+
+const char* MappedFile::Data(void) const
+{
+	return data;
+}
+
+size_t MappedFile::Size(void) const
+{
+	return size;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the
+//   object, so pointers returned by Data() must not outlive it.
+class MappedFile
+{
+public:
+	MappedFile(void);
+	~MappedFile(void);
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+	bool Open(const std::string & filename);
+	void Close(void);
+	bool IsOpen(void) const;
+	const char* Data(void) const;
+	size_t Size(void) const;
+private:
+	const char* data;
+	size_t size;
+	bool isopen;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int fd;
+#endif
+};
@@ -0,0 +1,151 @@
+#include <atomic>
+#include <memory>
+#include "MeshAdjacency.h"
+#include "MeshComponents.h"
+#include "MeshReduction.h"
+
+void MeshAdjacency::Build(const Mesh & mesh, const bool & parallel)
+{
+	const int nv = static_cast<int>(mesh.n_vertices());
+	const int nf = static_cast<int>(mesh.n_faces());
+	fv.assign(3 * static_cast<size_t>(nf), -1);
+	ff.assign(3 * static_cast<size_t>(nf), -1);
+	ThreadPool::Global().ParallelBlocks(nf, parallel, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			Mesh::FaceHandle fh(f);
+			if (mesh.status(fh).deleted()) continue;
+			auto heh = mesh.halfedge_handle(fh);
+			for (int k = 0; k < 3; ++k)
+			{
+				auto oh = mesh.face_handle(mesh.opposite_halfedge_handle(heh));
+				fv[3 * f + k] = mesh.to_vertex_handle(heh).idx();
+				ff[3 * f + k] = oh.is_valid() ? oh.idx() : -1;
+				heh = mesh.next_halfedge_handle(heh);
+			}
+		}
+	});
+
+	// count the neighbours, then fill every list at its offset
+	vvoffset.assign(nv + 1, 0);
+	vfoffset.assign(nv + 1, 0);
+	ThreadPool::Global().ParallelBlocks(nv, parallel, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			Mesh::VertexHandle vh(v);
+			if (mesh.status(vh).deleted()) continue;
+			for (const auto & heh : mesh.voh_range(vh))
+			{
+				++vvoffset[v + 1];
+				if (mesh.face_handle(heh).is_valid()) ++vfoffset[v + 1];
+			}
+		}
+	});
+	for (int v = 0; v < nv; ++v)
+	{
+		vvoffset[v + 1] += vvoffset[v];
+		vfoffset[v + 1] += vfoffset[v];
+	}
+	vv.resize(vvoffset[nv]);
+	vf.resize(vfoffset[nv]);
+	ThreadPool::Global().ParallelBlocks(nv, parallel, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			Mesh::VertexHandle vh(v);
+			if (mesh.status(vh).deleted()) continue;
+			int i = vvoffset[v], j = vfoffset[v];
+			for (const auto & heh : mesh.voh_range(vh))
+			{
+				vv[i++] = mesh.to_vertex_handle(heh).idx();
+				auto fh = mesh.face_handle(heh);
+				if (fh.is_valid()) vf[j++] = fh.idx();
+			}
+		}
+	});
+}
+
+void MeshAdjacency::Clear(void)
+{
+	std::vector<int>().swap(vvoffset);
+	std::vector<int>().swap(vv);
+	std::vector<int>().swap(vfoffset);
+	std::vector<int>().swap(vf);
+	std::vector<int>().swap(fv);
+	std::vector<int>().swap(ff);
+}
+
+int MeshAdjacency::NVertices(void) const
+{
+	return vvoffset.empty() ? 0 : static_cast<int>(vvoffset.size()) - 1;
+}
+
+int MeshAdjacency::NFaces(void) const
+{
+	return static_cast<int>(fv.size() / 3);
+}
+
+double MeshAdjacency::Area(const Mesh::Point* points, const bool & parallel) const
+{
+	// the blocks and the corner order of MeshReduction::Area, whose halfedge
+	//   of a face runs from corner 2 to corner 0
+	const int nf = NFaces();
+	const int blocksize = ThreadPool::blocksize;
+	std::vector<double> sums((nf + blocksize - 1) / blocksize, 0.0);
+	ThreadPool::Global().ParallelBlocks(nf, parallel, [&](int b, int begin, int end)
+	{
+		double values[blocksize];
+		for (int f = begin; f < end; ++f)
+		{
+			const int* corner = &fv[3 * f];
+			if (corner[0] < 0)
+			{
+				values[f - begin] = 0.0;
+				continue;
+			}
+			const auto & p0 = points[corner[2]];
+			const auto & p1 = points[corner[0]];
+			const auto & p2 = points[corner[1]];
+			values[f - begin] = 0.5 * ((p1 - p0) % (p2 - p0)).norm();
+		}
+		sums[b] = MeshReduction::PairwiseSum(values, end - begin);
+	});
+	return MeshReduction::PairwiseSum(sums.data(), static_cast<int>(sums.size()));
+}
+
+long long MeshAdjacency::BoundaryEdges(void) const
+{
+	// branch free, so that the scan vectorizes
+	long long n = 0;
+	const size_t size = ff.size();
+	for (size_t i = 0; i < size; ++i)
+	{
+		n += (ff[i] < 0) & (fv[i] >= 0);
+	}
+	return n;
+}
+
+int MeshAdjacency::Components(std::vector<int> & facecomponent) const
+{
+	// the union-find of MeshComponents, whose roots are the smallest faces
+	const int nf = NFaces();
+	std::unique_ptr<std::atomic<int>[]> parent(new std::atomic<int>[nf]);
+	ThreadPool::Global().ParallelBlocks(nf, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f) parent[f].store(f, std::memory_order_relaxed);
+	});
+	ThreadPool::Global().ParallelBlocks(nf, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				int g = ff[3 * f + k];
+				if (g > f) MeshComponents::Unite(parent.get(), f, g);
+			}
+		}
+	});
+	return MeshComponents::Number(parent.get(), nf, [&](int f) { return fv[3 * f] < 0; }, facecomponent);
+}
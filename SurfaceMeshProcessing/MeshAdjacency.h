@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "MeshDefinition.h"
+
+// A read-only snapshot of the connectivity of a triangle mesh in flat int
+//   arrays, for analysis kernels that scan them linearly instead of walking
+//   halfedges. Indices are the mesh's own; deleted vertices have no
+//   neighbours and deleted faces have -1 everywhere. The snapshot does not
+//   follow later changes of the mesh; build it again after editing.
+//
+//   The neighbours of vertex v are vv[vvoffset[v] .. vvoffset[v + 1]), in
+//   the order of its outgoing halfedges, and likewise its faces in vf.
+//   fv[3 f + k] is corner k of face f in fv_range order, and ff[3 f + k] is
+//   the face across the edge that ends at that corner, -1 on the boundary.
+class MeshAdjacency
+{
+public:
+	void Build(const Mesh & mesh, const bool & parallel = true);
+	void Clear(void);
+	int NVertices(void) const;
+	int NFaces(void) const;
+
+	// kernels on the snapshot alone, plus the points for Area
+	// equals MeshTools::Area bit for bit
+	double Area(const Mesh::Point* points, const bool & parallel = true) const;
+	long long BoundaryEdges(void) const;
+	// labels every face with its component over shared edges, 0, 1, ... in
+	//   the order of the first face, -1 for deleted faces; returns the count
+	int Components(std::vector<int> & facecomponent) const;
+public:
+	std::vector<int> vvoffset;
+	std::vector<int> vv;
+	std::vector<int> vfoffset;
+	std::vector<int> vf;
+	std::vector<int> fv;
+	std::vector<int> ff;
+};
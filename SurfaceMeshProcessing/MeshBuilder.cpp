@@ -0,0 +1,394 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include "MeshBuilder.h"
+#include "ThreadPool.h"
+
+size_t MeshBuilder::CleanFaces(int nvertices, const std::vector<int> & faceindices, const std::vector<int> & faceoffsets,
+	std::vector<int> & corners, std::vector<int> & facestart)
+{
+	size_t nskipped = 0;
+	corners.clear();
+	corners.reserve(faceindices.size());
+	facestart.assign(1, 0);
+	facestart.reserve(faceoffsets.size());
+	std::vector<int> polygon;
+	for (size_t i = 0; i + 1 < faceoffsets.size(); ++i)
+	{
+		size_t begin = corners.size();
+		bool valid = true;
+		for (int j = faceoffsets[i]; j < faceoffsets[i + 1]; ++j)
+		{
+			int idx = faceindices[j];
+			if (idx < 0 || idx >= nvertices)
+			{
+				valid = false;
+				break;
+			}
+			// drop repeated vertices, keeping the first occurrence
+			if (std::find(corners.begin() + begin, corners.end(), idx) == corners.end())
+			{
+				corners.push_back(idx);
+			}
+		}
+		if (!valid) ++nskipped;
+		//A minimum of three vertices are required.
+		size_t n = corners.size() - begin;
+		if (!valid || n < 3)
+		{
+			corners.resize(begin);
+			continue;
+		}
+		if (n == 3)
+		{
+			facestart.push_back(static_cast<int>(corners.size()));
+			continue;
+		}
+		// a polygon becomes the fan of triangles (v0, vi, vi+1) that
+		//   TriMesh::add_face makes of it
+		polygon.assign(corners.begin() + begin, corners.end());
+		corners.resize(begin);
+		for (size_t k = 1; k + 1 < n; ++k)
+		{
+			corners.push_back(polygon[0]);
+			corners.push_back(polygon[k]);
+			corners.push_back(polygon[k + 1]);
+			facestart.push_back(static_cast<int>(corners.size()));
+		}
+	}
+	if (nskipped > 0)
+	{
+		std::cerr << "  Warning! Skipped " << nskipped << " faces with out of range vertex indices.\n";
+	}
+	return nskipped;
+}
+
+bool MeshBuilder::BuildSequential(Mesh & mesh, const std::vector<Mesh::Point> & points,
+	const std::vector<int> & faceindices, const std::vector<int> & faceoffsets, LoadProgress* progress)
+{
+	std::vector<int> corners, facestart;
+	CleanFaces(static_cast<int>(points.size()), faceindices, faceoffsets, corners, facestart);
+	size_t nfaces = facestart.size() - 1;
+	if (progress)
+	{
+		progress->facesbuilt = 0;
+		progress->facestotal = nfaces;
+	}
+	mesh.clear();
+	mesh.reserve(points.size(), points.size() + nfaces, nfaces);
+	for (const auto & p : points)
+	{
+		mesh.add_vertex(p);
+	}
+	std::vector<Mesh::VertexHandle> faceVertices;
+	for (size_t i = 0; i < nfaces; ++i)
+	{
+		faceVertices.clear();
+		for (int c = facestart[i]; c < facestart[i + 1]; ++c)
+		{
+			faceVertices.push_back(Mesh::VertexHandle(corners[c]));
+		}
+		mesh.add_face(faceVertices);
+		if (progress && (i + 1) % 65536 == 0)
+		{
+			progress->facesbuilt = i + 1;
+			if (progress->cancelled) return false;
+		}
+	}
+	if (progress) progress->facesbuilt = nfaces;
+	MeshTools::Modified(mesh);
+	return true;
+}
+
+bool MeshBuilder::Build(Mesh & mesh, const std::vector<Mesh::Point> & points,
+	const std::vector<int> & faceindices, const std::vector<int> & faceoffsets, LoadProgress* progress)
+{
+	const int nvertices = static_cast<int>(points.size());
+	std::vector<int> corners, facestart;
+	CleanFaces(nvertices, faceindices, faceoffsets, corners, facestart);
+	const int nfaces = static_cast<int>(facestart.size()) - 1;
+	const int ncorners = static_cast<int>(corners.size());
+	if (progress)
+	{
+		progress->facesbuilt = 0;
+		progress->facestotal = nfaces;
+	}
+	// the connectivity phases are not interruptible, so cancellation is
+	//   checked between them
+	auto cancelled = [&] { return progress && progress->cancelled; };
+
+	// corner c is the halfedge corners[c] -> corners[nextcorner[c]]
+	std::vector<int> nextcorner(ncorners);
+	ThreadPool::Global().ParallelBlocks(nfaces, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			for (int c = facestart[f]; c < facestart[f + 1] - 1; ++c)
+			{
+				nextcorner[c] = c + 1;
+			}
+			nextcorner[facestart[f + 1] - 1] = facestart[f];
+		}
+	});
+	auto to = [&](int c) { return corners[nextcorner[c]]; };
+
+	// counting sort of the corners by source vertex, then by target vertex
+	//   within each vertex so twins can be found by binary search
+	std::vector<int> outstart(nvertices + 1, 0);
+	for (int c = 0; c < ncorners; ++c)
+	{
+		++outstart[corners[c] + 1];
+	}
+	for (int v = 0; v < nvertices; ++v)
+	{
+		outstart[v + 1] += outstart[v];
+	}
+	std::vector<int> outcorners(ncorners);
+	{
+		std::vector<int> fill(outstart.begin(), outstart.end() - 1);
+		for (int c = 0; c < ncorners; ++c)
+		{
+			outcorners[fill[corners[c]]++] = c;
+		}
+	}
+	ThreadPool::Global().ParallelBlocks(nvertices, true, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			std::sort(outcorners.begin() + outstart[v], outcorners.begin() + outstart[v + 1], [&](int a, int b)
+			{
+				return to(a) < to(b) || (to(a) == to(b) && a < b);
+			});
+		}
+	});
+
+	if (cancelled()) return false;
+
+	// twins, and the oriented edges used more than once
+	std::vector<int> twin(ncorners, -1);
+	std::atomic<bool> conflict(false);
+	ThreadPool::Global().ParallelBlocks(nvertices, true, [&](int, int begin, int end)
+	{
+		bool bad = false;
+		for (int v = begin; v < end; ++v)
+		{
+			for (int k = outstart[v]; k < outstart[v + 1]; ++k)
+			{
+				int c = outcorners[k];
+				int w = to(c);
+				if (k + 1 < outstart[v + 1] && to(outcorners[k + 1]) == w)
+				{
+					bad = true;
+				}
+				auto first = outcorners.begin() + outstart[w];
+				auto last = outcorners.begin() + outstart[w + 1];
+				auto it = std::lower_bound(first, last, v, [&](int a, int value) { return to(a) < value; });
+				if (it != last && to(*it) == v)
+				{
+					twin[c] = *it;
+				}
+			}
+		}
+		if (bad) conflict = true;
+	});
+	if (conflict)
+	{
+		return BuildSequential(mesh, points, faceindices, faceoffsets, progress);
+	}
+	if (cancelled()) return false;
+
+	// edges are numbered by their first corner in face order, and halfedge
+	//   2e runs in the direction of that corner, as add_face does
+	int nedges = 0;
+	std::vector<int> halfedge(ncorners);
+	for (int c = 0; c < ncorners; ++c)
+	{
+		if (twin[c] < 0 || c < twin[c])
+		{
+			halfedge[c] = 2 * nedges++;
+			if (twin[c] >= 0) halfedge[twin[c]] = halfedge[c] + 1;
+		}
+	}
+	// the face side of each halfedge, -1 for boundary halfedges
+	std::vector<int> halfedgecorner(2 * static_cast<size_t>(nedges), -1);
+	for (int c = 0; c < ncorners; ++c)
+	{
+		halfedgecorner[halfedge[c]] = c;
+	}
+	if (cancelled()) return false;
+
+	// replay add_face around every vertex. add_face changes only the next
+	//   links of the halfedges entering a vertex of the new face, the prev
+	//   links of those leaving it and its outgoing halfedge, from the links
+	//   of that vertex alone, so every vertex can follow its own faces in
+	//   order and ends up with the links and outgoing halfedge the per-face
+	//   path gives it, including the order of several fans around it. A face
+	//   add_face refuses (on a vertex whose fan is closed, or whose gaps it
+	//   cannot relink) hands the input over to the per-face path.
+	//   prevcorner(c) is the corner of the same face that ends at corners[c].
+	std::vector<int> prevcorner(ncorners);
+	ThreadPool::Global().ParallelBlocks(ncorners, true, [&](int, int begin, int end)
+	{
+		for (int c = begin; c < end; ++c)
+		{
+			prevcorner[nextcorner[c]] = c;
+		}
+	});
+	std::vector<int> nexthalfedge(2 * static_cast<size_t>(nedges), -1);
+	std::vector<int> prevhalfedge(2 * static_cast<size_t>(nedges), -1);
+	std::vector<int> vertexhalfedge(nvertices, -1);
+	ThreadPool::Global().ParallelBlocks(nvertices, true, [&](int, int begin, int end)
+	{
+		std::vector<int> faces;
+		std::vector<std::pair<int, int>> links;
+		// whether halfedge h has no face yet when the face starting at corner
+		//   limit is added
+		auto boundary = [&](int h, int limit) { return halfedgecorner[h] < 0 || halfedgecorner[h] >= limit; };
+		bool bad = false;
+		for (int v = begin; v < end && !bad; ++v)
+		{
+			// the corners leaving v, in face order
+			faces.assign(outcorners.begin() + outstart[v], outcorners.begin() + outstart[v + 1]);
+			std::sort(faces.begin(), faces.end());
+			int & outgoing = vertexhalfedge[v];
+			for (int c : faces)
+			{
+				int p = prevcorner[c];
+				int facebegin = std::min({ p, c, nextcorner[c] });
+				int faceend = std::max({ p, c, nextcorner[c] }) + 1;
+				if (outgoing >= 0 && !boundary(outgoing, facebegin))
+				{
+					bad = true;
+					break;
+				}
+				// the edges of p and c are new unless an earlier face has them
+				int innerprev = halfedge[p], innernext = halfedge[c];
+				bool prevnew = twin[p] < 0 || twin[p] > p;
+				bool nextnew = twin[c] < 0 || twin[c] > c;
+				bool adjust = false;
+				links.clear();
+				if (!prevnew && !nextnew)
+				{
+					if (nexthalfedge[innerprev] != innernext)
+					{
+						// move the faces between the two edges to the next gap
+						int boundaryprev = innernext ^ 1;
+						do
+						{
+							boundaryprev = nexthalfedge[boundaryprev] ^ 1;
+						} while (!boundary(boundaryprev, facebegin));
+						if (boundaryprev == innerprev)
+						{
+							bad = true;
+							break;
+						}
+						links.emplace_back(boundaryprev, nexthalfedge[innerprev]);
+						links.emplace_back(prevhalfedge[innernext], nexthalfedge[boundaryprev]);
+						links.emplace_back(innerprev, innernext);
+					}
+					adjust = outgoing == innernext;
+				}
+				else
+				{
+					int outerprev = innernext ^ 1, outernext = innerprev ^ 1;
+					if (!nextnew)
+					{
+						links.emplace_back(prevhalfedge[innernext], outernext);
+						outgoing = outernext;
+					}
+					else if (!prevnew)
+					{
+						links.emplace_back(outerprev, nexthalfedge[innerprev]);
+						outgoing = nexthalfedge[innerprev];
+					}
+					else if (outgoing < 0)
+					{
+						links.emplace_back(outerprev, outernext);
+						outgoing = outernext;
+					}
+					else
+					{
+						links.emplace_back(prevhalfedge[outgoing], outernext);
+						links.emplace_back(outerprev, outgoing);
+					}
+					links.emplace_back(innerprev, innernext);
+				}
+				for (const auto & link : links)
+				{
+					nexthalfedge[link.first] = link.second;
+					prevhalfedge[link.second] = link.first;
+				}
+				if (adjust)
+				{
+					// the first boundary halfedge clockwise, as
+					//   adjust_outgoing_halfedge picks it
+					int h = outgoing;
+					do
+					{
+						if (boundary(h, faceend))
+						{
+							outgoing = h;
+							break;
+						}
+						h = nexthalfedge[h ^ 1];
+					} while (h != outgoing);
+				}
+			}
+		}
+		if (bad) conflict = true;
+	});
+	if (conflict)
+	{
+		return BuildSequential(mesh, points, faceindices, faceoffsets, progress);
+	}
+	if (cancelled()) return false;
+
+	mesh.clear();
+	mesh.reserve(nvertices, nedges, nfaces);
+	for (const auto & p : points)
+	{
+		mesh.add_vertex(p);
+	}
+	for (int c = 0; c < ncorners; ++c)
+	{
+		if (twin[c] < 0 || c < twin[c])
+		{
+			mesh.new_edge(Mesh::VertexHandle(corners[c]), Mesh::VertexHandle(to(c)));
+		}
+	}
+	for (int f = 0; f < nfaces; ++f)
+	{
+		mesh.new_face();
+	}
+	if (cancelled()) return false;
+	ThreadPool::Global().ParallelBlocks(nfaces, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			Mesh::FaceHandle fh(f);
+			for (int c = facestart[f]; c < facestart[f + 1]; ++c)
+			{
+				mesh.set_face_handle(Mesh::HalfedgeHandle(halfedge[c]), fh);
+			}
+			mesh.set_halfedge_handle(fh, Mesh::HalfedgeHandle(halfedge[facestart[f + 1] - 1]));
+		}
+		if (progress) progress->facesbuilt += end - begin;
+	});
+	ThreadPool::Global().ParallelBlocks(2 * nedges, true, [&](int, int begin, int end)
+	{
+		for (int h = begin; h < end; ++h)
+		{
+			mesh.set_next_halfedge_handle(Mesh::HalfedgeHandle(h), Mesh::HalfedgeHandle(nexthalfedge[h]));
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(nvertices, true, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			if (vertexhalfedge[v] < 0) continue;
+			mesh.set_halfedge_handle(Mesh::VertexHandle(v), Mesh::HalfedgeHandle(vertexhalfedge[v]));
+		}
+	});
+	MeshTools::Modified(mesh);
+	return true;
+}
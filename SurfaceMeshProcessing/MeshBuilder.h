@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "MeshDefinition.h"
+
+// Builds the connectivity of a Mesh from a flat polygon index buffer in one
+//   go instead of calling add_face per face. Face i uses the 0-based vertex
+//   indices faceindices[faceoffsets[i]] up to faceindices[faceoffsets[i + 1]].
+//   Repeated vertices in a face are dropped, faces with fewer than three
+//   vertices are skipped, and faces with out of range indices are skipped with a
+//   warning. Polygons are split into the triangle fan (v0, vi, vi+1), as
+//   TriMesh::add_face splits them. Vertices, edges and faces get the same
+//   indices and links add_face would give them when the faces are added in
+//   order, down to the outgoing halfedge of every vertex.
+//
+//   Halfedge twins are matched with a counting sort of the corners by source
+//   vertex, then each vertex replays what add_face does to its links.
+//   Input that add_face would reject (an oriented edge used twice, a face
+//   added to a vertex whose fan is already closed, or one whose gaps cannot
+//   be relinked) is handed over to the per-face path so the result stays
+//   identical to it. SurfaceMeshTests checks both against each other.
+//
+//   Both return false, leaving the mesh incomplete, only if progress->cancelled
+//   was set while building.
+class MeshBuilder
+{
+public:
+	static bool Build(Mesh & mesh, const std::vector<Mesh::Point> & points,
+		const std::vector<int> & faceindices, const std::vector<int> & faceoffsets, LoadProgress* progress = nullptr);
+	// the same input added with add_face one face at a time
+	static bool BuildSequential(Mesh & mesh, const std::vector<Mesh::Point> & points,
+		const std::vector<int> & faceindices, const std::vector<int> & faceoffsets, LoadProgress* progress = nullptr);
+private:
+	static size_t CleanFaces(int nvertices, const std::vector<int> & faceindices, const std::vector<int> & faceoffsets,
+		std::vector<int> & corners, std::vector<int> & facestart);
+};
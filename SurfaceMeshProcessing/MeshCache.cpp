@@ -0,0 +1,337 @@
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <atomic>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include "MeshCache.h"
+#include "MeshCompactor.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	enum CacheArray
+	{
+		POINTS, VERTEX_NORMALS, FACE_NORMALS, VERTEX_HALFEDGE,
+		HALFEDGE_VERTEX, HALFEDGE_NEXT, HALFEDGE_FACE, FACE_HALFEDGE, N_ARRAYS
+	};
+
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteorder;
+		uint32_t scalarsize;
+		uint32_t hasnormals;
+		uint64_t sourcesize;
+		int64_t sourcemtime;
+		uint64_t nvertices;
+		uint64_t nedges;
+		uint64_t nfaces;
+		uint64_t offsets[N_ARRAYS];
+		uint64_t sizes[N_ARRAYS];
+	};
+
+	const char CacheMagic[8] = { 'S', 'M', 'P', 'M', 'E', 'S', 'H', '\0' };
+	const uint32_t CacheByteOrder = 0x01020304;
+
+	bool SourceStamp(const std::string & source, uint64_t & size, int64_t & mtime)
+	{
+		std::error_code ec;
+		std::filesystem::path path(source);
+		size = std::filesystem::file_size(path, ec);
+		if (ec) return false;
+		auto time = std::filesystem::last_write_time(path, ec);
+		if (ec) return false;
+		mtime = static_cast<int64_t>(time.time_since_epoch().count());
+		return true;
+	}
+
+	bool HasDeleted(const Mesh & mesh)
+	{
+		std::atomic<bool> deleted(false);
+		ThreadPool::Global().ParallelBlocks(static_cast<int>(mesh.n_vertices()), true, [&](int, int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				if (mesh.status(Mesh::VertexHandle(i)).deleted()) deleted.store(true, std::memory_order_relaxed);
+			}
+		});
+		ThreadPool::Global().ParallelBlocks(static_cast<int>(mesh.n_edges()), true, [&](int, int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				if (mesh.status(Mesh::EdgeHandle(i)).deleted()) deleted.store(true, std::memory_order_relaxed);
+			}
+		});
+		ThreadPool::Global().ParallelBlocks(static_cast<int>(mesh.n_faces()), true, [&](int, int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				if (mesh.status(Mesh::FaceHandle(i)).deleted()) deleted.store(true, std::memory_order_relaxed);
+			}
+		});
+		return deleted;
+	}
+}
+
+const unsigned int MeshCache::Version = 1;
+
+std::string MeshCache::CacheName(const std::string & filename)
+{
+	return filename + ".smc";
+}
+
+bool MeshCache::Write(const Mesh & mesh, const std::string & filename, const std::string & source)
+{
+	// the deleted flags are not stored, so they are removed from a copy first
+	if (HasDeleted(mesh))
+	{
+		Mesh compacted(mesh);
+		MeshCompactor::Compact(compacted);
+		return Write(compacted, filename, source);
+	}
+	CacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+	header.version = Version;
+	header.byteorder = CacheByteOrder;
+	header.scalarsize = sizeof(Mesh::Point::value_type);
+	header.hasnormals = mesh.has_vertex_normals() && mesh.has_face_normals();
+	if (!source.empty() && !SourceStamp(source, header.sourcesize, header.sourcemtime))
+	{
+		return false;
+	}
+	const size_t nv = mesh.n_vertices(), nh = mesh.n_halfedges(), nf = mesh.n_faces();
+	header.nvertices = nv;
+	header.nedges = mesh.n_edges();
+	header.nfaces = nf;
+	header.sizes[POINTS] = nv * sizeof(Mesh::Point);
+	header.sizes[VERTEX_NORMALS] = header.hasnormals ? nv * sizeof(Mesh::Normal) : 0;
+	header.sizes[FACE_NORMALS] = header.hasnormals ? nf * sizeof(Mesh::Normal) : 0;
+	header.sizes[VERTEX_HALFEDGE] = nv * sizeof(int32_t);
+	header.sizes[HALFEDGE_VERTEX] = nh * sizeof(int32_t);
+	header.sizes[HALFEDGE_NEXT] = nh * sizeof(int32_t);
+	header.sizes[HALFEDGE_FACE] = nh * sizeof(int32_t);
+	header.sizes[FACE_HALFEDGE] = nf * sizeof(int32_t);
+	uint64_t offset = (sizeof(CacheHeader) + 63) / 64 * 64;
+	for (int i = 0; i < N_ARRAYS; ++i)
+	{
+		header.offsets[i] = offset;
+		offset += (header.sizes[i] + 63) / 64 * 64;
+	}
+
+	std::vector<int32_t> vertexhalfedge(nv), halfedgevertex(nh), halfedgenext(nh), halfedgeface(nh), facehalfedge(nf);
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nv), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			vertexhalfedge[i] = mesh.halfedge_handle(Mesh::VertexHandle(i)).idx();
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nh), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::HalfedgeHandle heh(i);
+			halfedgevertex[i] = mesh.to_vertex_handle(heh).idx();
+			halfedgenext[i] = mesh.next_halfedge_handle(heh).idx();
+			halfedgeface[i] = mesh.face_handle(heh).idx();
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nf), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			facehalfedge[i] = mesh.halfedge_handle(Mesh::FaceHandle(i)).idx();
+		}
+	});
+	const void* arrays[N_ARRAYS] = {
+		mesh.points(),
+		header.hasnormals ? mesh.vertex_normals() : nullptr,
+		header.hasnormals ? mesh.face_normals() : nullptr,
+		vertexhalfedge.data(), halfedgevertex.data(), halfedgenext.data(), halfedgeface.data(), facehalfedge.data() };
+
+	// write to a temporary name so a cache is never seen half-written
+	std::string tmpname = filename + ".tmp";
+	{
+		std::ofstream ofs(tmpname, std::ios::binary | std::ios::trunc);
+		if (!ofs.is_open())
+		{
+			std::cerr << "Error: cannot open file " << tmpname << std::endl;
+			return false;
+		}
+		const char zeros[64] = { 0 };
+		ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		ofs.write(zeros, header.offsets[0] - sizeof(header));
+		for (int i = 0; i < N_ARRAYS; ++i)
+		{
+			if (header.sizes[i] == 0) continue;
+			ofs.write(static_cast<const char*>(arrays[i]), header.sizes[i]);
+			ofs.write(zeros, (header.sizes[i] + 63) / 64 * 64 - header.sizes[i]);
+		}
+		if (!ofs)
+		{
+			std::cerr << "Error: cannot write file " << tmpname << std::endl;
+			ofs.close();
+			std::remove(tmpname.c_str());
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmpname, filename, ec);
+	if (ec)
+	{
+		std::remove(tmpname.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Read(Mesh & mesh, const std::string & filename, const std::string & source, LoadProgress* progress)
+{
+	MappedFile file;
+	if (!file.Open(filename) || file.Size() < sizeof(CacheHeader)) return false;
+	CacheHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+		header.version != Version ||
+		header.byteorder != CacheByteOrder ||
+		header.scalarsize != sizeof(Mesh::Point::value_type))
+	{
+		return false;
+	}
+	if (!source.empty())
+	{
+		uint64_t sourcesize;
+		int64_t sourcemtime;
+		if (!SourceStamp(source, sourcesize, sourcemtime) ||
+			sourcesize != header.sourcesize || sourcemtime != header.sourcemtime)
+		{
+			return false;
+		}
+	}
+	// handles are ints
+	if (header.nvertices > INT_MAX || header.nedges > INT_MAX / 2 || header.nfaces > INT_MAX)
+	{
+		std::cerr << "  Warning! Mesh cache " << filename << " is damaged.\n";
+		return false;
+	}
+	const size_t nv = header.nvertices, ne = header.nedges, nh = 2 * ne, nf = header.nfaces;
+	const uint64_t expected[N_ARRAYS] = {
+		nv * sizeof(Mesh::Point),
+		header.hasnormals ? nv * sizeof(Mesh::Normal) : 0,
+		header.hasnormals ? nf * sizeof(Mesh::Normal) : 0,
+		nv * sizeof(int32_t), nh * sizeof(int32_t), nh * sizeof(int32_t), nh * sizeof(int32_t), nf * sizeof(int32_t) };
+	for (int i = 0; i < N_ARRAYS; ++i)
+	{
+		if (header.sizes[i] != expected[i] || header.offsets[i] % sizeof(int32_t) != 0 ||
+			header.offsets[i] > file.Size() || header.sizes[i] > file.Size() - header.offsets[i])
+		{
+			std::cerr << "  Warning! Mesh cache " << filename << " is damaged.\n";
+			return false;
+		}
+	}
+	auto array = [&](int i) { return file.Data() + header.offsets[i]; };
+	const int32_t* vertexhalfedge = reinterpret_cast<const int32_t*>(array(VERTEX_HALFEDGE));
+	const int32_t* halfedgevertex = reinterpret_cast<const int32_t*>(array(HALFEDGE_VERTEX));
+	const int32_t* halfedgenext = reinterpret_cast<const int32_t*>(array(HALFEDGE_NEXT));
+	const int32_t* halfedgeface = reinterpret_cast<const int32_t*>(array(HALFEDGE_FACE));
+	const int32_t* facehalfedge = reinterpret_cast<const int32_t*>(array(FACE_HALFEDGE));
+
+	if (progress)
+	{
+		progress->bytestotal = file.Size();
+		progress->facestotal = nf;
+	}
+	auto cancelled = [&] { return progress && progress->cancelled; };
+	auto checked = [&](int begin, int end, size_t bytes)
+	{
+		if (progress) progress->bytesparsed += (end - begin) * bytes;
+	};
+
+	// every handle has to be in range before anything is written through it
+	std::atomic<bool> valid(true);
+	auto inrange = [](int32_t idx, size_t n, bool allowinvalid)
+	{
+		return (allowinvalid && idx == -1) || (idx >= 0 && static_cast<size_t>(idx) < n);
+	};
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nv), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (!inrange(vertexhalfedge[i], nh, true)) valid = false;
+		}
+		checked(begin, end, sizeof(int32_t));
+	});
+	if (cancelled()) return false;
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nh), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (!inrange(halfedgevertex[i], nv, false) || !inrange(halfedgenext[i], nh, false) ||
+				!inrange(halfedgeface[i], nf, true))
+			{
+				valid = false;
+			}
+		}
+		checked(begin, end, 3 * sizeof(int32_t));
+	});
+	if (cancelled()) return false;
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nf), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (!inrange(facehalfedge[i], nh, false)) valid = false;
+		}
+		checked(begin, end, sizeof(int32_t));
+	});
+	if (cancelled()) return false;
+	if (!valid)
+	{
+		std::cerr << "  Warning! Mesh cache " << filename << " is damaged.\n";
+		return false;
+	}
+
+	mesh.clear();
+	mesh.resize(nv, ne, nf);
+	std::memcpy(mesh.property(mesh.points_pph()).data_vector().data(), array(POINTS), header.sizes[POINTS]);
+	if (header.hasnormals && mesh.has_vertex_normals() && mesh.has_face_normals())
+	{
+		std::memcpy(mesh.property(mesh.vertex_normals_pph()).data_vector().data(), array(VERTEX_NORMALS), header.sizes[VERTEX_NORMALS]);
+		std::memcpy(mesh.property(mesh.face_normals_pph()).data_vector().data(), array(FACE_NORMALS), header.sizes[FACE_NORMALS]);
+	}
+	if (progress) progress->bytesparsed = progress->bytestotal.load();
+	if (cancelled()) return false;
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nv), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			mesh.set_halfedge_handle(Mesh::VertexHandle(i), Mesh::HalfedgeHandle(vertexhalfedge[i]));
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nh), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::HalfedgeHandle heh(i);
+			mesh.set_vertex_handle(heh, Mesh::VertexHandle(halfedgevertex[i]));
+			mesh.set_next_halfedge_handle(heh, Mesh::HalfedgeHandle(halfedgenext[i]));
+			mesh.set_face_handle(heh, Mesh::FaceHandle(halfedgeface[i]));
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(static_cast<int>(nf), true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			mesh.set_halfedge_handle(Mesh::FaceHandle(i), Mesh::HalfedgeHandle(facehalfedge[i]));
+		}
+		if (progress) progress->facesbuilt += end - begin;
+	});
+	if (!header.hasnormals) mesh.update_normals();
+	MeshTools::Modified(mesh);
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include "MeshDefinition.h"
+
+// Versioned binary snapshot of a Mesh: the point, normal and connectivity
+//   arrays are stored as they are laid out in memory, so loading maps the file
+//   and copies the arrays back without any parsing or topology rebuild.
+//
+//   A cache written for a source file records that file's size and
+//   modification time; Read with the same source refuses the cache once either
+//   changed. Deleted flags are not stored, so Write stores a mesh with
+//   deleted elements as a compacted copy (see MeshCompactor).
+class MeshCache
+{
+public:
+	static const unsigned int Version;
+	// sidecar cache file used for a source mesh file
+	static std::string CacheName(const std::string & filename);
+	static bool Write(const Mesh & mesh, const std::string & filename, const std::string & source = "");
+	// Reads the normals too, or computes them if the cache has none. progress,
+	//   if given, counts the bytes checked and the faces restored, and a
+	//   cancelled read returns false.
+	static bool Read(Mesh & mesh, const std::string & filename, const std::string & source = "", LoadProgress* progress = nullptr);
+};
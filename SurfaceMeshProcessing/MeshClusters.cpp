@@ -0,0 +1,253 @@
+#include <cmath>
+#include <algorithm>
+#include "MeshClusters.h"
+#include "MeshReorder.h"
+#include "ThreadPool.h"
+
+MeshClusters::CullStats::CullStats(void)
+	: nclusters(0),
+	nfrustumculled(0),
+	nbackfaceculled(0),
+	ntriangles(0),
+	ndrawntriangles(0)
+{
+}
+
+void MeshClusters::Build(const Mesh & mesh)
+{
+	std::vector<int> vertexmap, facemap;
+	MeshReorder::VertexOrder(mesh, MeshReorder::ORDER_MORTON, vertexmap);
+	MeshReorder::FaceOrder(mesh, vertexmap, facemap);
+	const int nf = static_cast<int>(mesh.n_faces());
+	int nkept = 0;
+	for (int f = 0; f < nf; ++f)
+	{
+		if (!mesh.status(Mesh::FaceHandle(f)).deleted()) ++nkept;
+	}
+	faces.assign(nkept, -1);
+	for (int f = 0; f < nf; ++f)
+	{
+		if (facemap[f] < nkept) faces[facemap[f]] = f;
+	}
+	UpdateBounds(mesh);
+}
+
+void MeshClusters::UpdateBounds(const Mesh & mesh)
+{
+	const int n = static_cast<int>(faces.size());
+	const int nclusters = (n + clustersize - 1) / clustersize;
+	bounds.resize(nclusters);
+	ThreadPool::Global().ParallelFor(nclusters, [&](int c)
+	{
+		const int begin = c * clustersize;
+		const int end = std::min(n, begin + clustersize);
+		Mesh::Point bmin(0.0), bmax(0.0), sum(0.0);
+		bool first = true;
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::FaceHandle fh(faces[i]);
+			sum += mesh.normal(fh);
+			for (const auto & fvh : mesh.fv_range(fh))
+			{
+				const Mesh::Point & p = mesh.point(fvh);
+				if (first)
+				{
+					bmin = bmax = p;
+					first = false;
+				}
+				bmin.minimize(p);
+				bmax.maximize(p);
+			}
+		}
+		// the radius is measured from the center as stored
+		Bounds & b = bounds[c];
+		for (int k = 0; k < 3; ++k)
+		{
+			b.center[k] = static_cast<float>((bmin[k] + bmax[k]) * 0.5);
+		}
+		double radius2 = 0.0;
+		for (int i = begin; i < end; ++i)
+		{
+			for (const auto & fvh : mesh.fv_range(Mesh::FaceHandle(faces[i])))
+			{
+				const Mesh::Point & p = mesh.point(fvh);
+				double d2 = 0.0;
+				for (int k = 0; k < 3; ++k)
+				{
+					d2 += (p[k] - static_cast<double>(b.center[k])) * (p[k] - static_cast<double>(b.center[k]));
+				}
+				radius2 = std::max(radius2, d2);
+			}
+		}
+		// the narrowest normal is the cosine of the half angle
+		const double length = sum.norm();
+		double cosangle = length > 0.0 ? 1.0 : -1.0;
+		for (int i = begin; i < end && cosangle > 0.0; ++i)
+		{
+			cosangle = std::min(cosangle, static_cast<double>(sum | mesh.normal(Mesh::FaceHandle(faces[i]))) / length);
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			b.axis[k] = length > 0.0 ? static_cast<float>(sum[k] / length) : 0.0f;
+		}
+		// rounded up, so that the sphere still holds every point
+		b.radius = std::nextafter(static_cast<float>(std::sqrt(radius2)), HUGE_VALF);
+		if (cosangle > 0.0)
+		{
+			// rounded towards the wider cone
+			b.cosangle = std::nextafter(static_cast<float>(cosangle), -HUGE_VALF);
+			b.sinangle = std::nextafter(static_cast<float>(std::sqrt(1.0 - cosangle * cosangle)), HUGE_VALF);
+		}
+		else
+		{
+			b.cosangle = -1.0f;
+			b.sinangle = 0.0f;
+		}
+	});
+	for (int k = 0; k < 3; ++k)
+	{
+		bmin[k] = bmax[k] = 0.0f;
+	}
+	for (int c = 0; c < nclusters; ++c)
+	{
+		const Bounds & b = bounds[c];
+		for (int k = 0; k < 3; ++k)
+		{
+			if (c == 0 || b.center[k] - b.radius < bmin[k]) bmin[k] = b.center[k] - b.radius;
+			if (c == 0 || b.center[k] + b.radius > bmax[k]) bmax[k] = b.center[k] + b.radius;
+		}
+	}
+}
+
+void MeshClusters::Clear(void)
+{
+	std::vector<int>().swap(faces);
+	std::vector<Bounds>().swap(bounds);
+	for (int k = 0; k < 3; ++k)
+	{
+		bmin[k] = bmax[k] = 0.0f;
+	}
+}
+
+int MeshClusters::NClusters(void) const
+{
+	return static_cast<int>(bounds.size());
+}
+
+void MeshClusters::Cull(const double* modelview, const double* projection, const bool & backfaces, std::vector<std::pair<int, int>> & ranges, CullStats & stats) const
+{
+	ranges.clear();
+	stats = CullStats();
+	const int n = static_cast<int>(faces.size());
+	stats.nclusters = NClusters();
+	stats.ntriangles = n;
+
+	// the frustum planes a x + b y + c z + d >= 0 in object space are sums
+	//   and differences of the rows of projection * modelview
+	double m[16];
+	for (int j = 0; j < 4; ++j)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			m[4 * j + i] = 0.0;
+			for (int k = 0; k < 4; ++k) m[4 * j + i] += projection[4 * k + i] * modelview[4 * j + k];
+		}
+	}
+	double planes[6][4];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			planes[2 * i][j] = m[4 * j + 3] + m[4 * j + i];
+			planes[2 * i + 1][j] = m[4 * j + 3] - m[4 * j + i];
+		}
+	}
+	for (auto & p : planes)
+	{
+		const double length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (length > 0.0)
+		{
+			for (int j = 0; j < 4; ++j) p[j] /= length;
+		}
+	}
+	// the eye, or for a parallel projection the viewing direction, in object
+	//   space; the inverse of a rotation is its transpose
+	const bool perspective = projection[15] == 0.0;
+	double eye[3];
+	for (int j = 0; j < 3; ++j)
+	{
+		eye[j] = perspective
+			? -(modelview[4 * j] * modelview[12] + modelview[4 * j + 1] * modelview[13] + modelview[4 * j + 2] * modelview[14])
+			: -modelview[4 * j + 2];
+	}
+	// inside the mesh, or with the near plane cutting into it, the back
+	//   sides are what is seen; planes[4] is the near plane
+	bool cutnear = false;
+	for (int corner = 0; corner < 8 && !cutnear; ++corner)
+	{
+		double d = planes[4][3];
+		for (int k = 0; k < 3; ++k)
+		{
+			d += planes[4][k] * ((corner >> k) & 1 ? bmax[k] : bmin[k]);
+		}
+		cutnear = d < 0.0;
+	}
+	const bool cullbackfaces = backfaces && !cutnear;
+
+	for (int c = 0; c < stats.nclusters; ++c)
+	{
+		const Bounds & b = bounds[c];
+		bool visible = true;
+		for (const auto & p : planes)
+		{
+			if (p[0] * b.center[0] + p[1] * b.center[1] + p[2] * b.center[2] + p[3] < -b.radius)
+			{
+				visible = false;
+				++stats.nfrustumculled;
+				break;
+			}
+		}
+		// every face faces away if the direction to any point of the sphere is
+		//   within 90 degrees of every normal in the cone: the angle to the
+		//   axis plus the cone's half angle plus the sphere's angular radius
+		//   stays below 90 degrees
+		if (visible && cullbackfaces && b.cosangle > 0.0f)
+		{
+			double v[3], sinr = 0.0, cosr = 1.0;
+			if (perspective)
+			{
+				for (int k = 0; k < 3; ++k) v[k] = b.center[k] - eye[k];
+			}
+			else
+			{
+				for (int k = 0; k < 3; ++k) v[k] = eye[k];
+			}
+			const double d = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+			if (perspective && d > b.radius)
+			{
+				sinr = b.radius / d;
+				cosr = std::sqrt(1.0 - sinr * sinr);
+			}
+			const double cosangle = b.cosangle * cosr - b.sinangle * sinr;
+			const double sinangle = b.sinangle * cosr + b.cosangle * sinr;
+			if ((!perspective || d > b.radius) && d > 0.0 && cosangle > 0.0
+				&& (v[0] * b.axis[0] + v[1] * b.axis[1] + v[2] * b.axis[2]) > sinangle * d)
+			{
+				visible = false;
+				++stats.nbackfaceculled;
+			}
+		}
+		if (!visible) continue;
+		const int begin = c * clustersize;
+		const int count = std::min(n, begin + clustersize) - begin;
+		if (!ranges.empty() && ranges.back().first + ranges.back().second == begin)
+		{
+			ranges.back().second += count;
+		}
+		else
+		{
+			ranges.emplace_back(begin, count);
+		}
+		stats.ndrawntriangles += count;
+	}
+}
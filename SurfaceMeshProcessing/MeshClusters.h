@@ -0,0 +1,60 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include "MeshDefinition.h"
+
+// Spatially coherent runs of faces ("meshlets") with bounds for culling on
+//   the CPU. The live faces are put in the order MeshReorder gives them after
+//   the Morton vertex order, and every clustersize consecutive faces form a
+//   cluster with a bounding sphere and a cone around all its face normals.
+//   A renderer that uploads the faces in this order draws only the ranges
+//   Cull returns.
+class MeshClusters
+{
+public:
+	struct Bounds
+	{
+		float center[3];
+		float radius;
+		float axis[3];
+		// of the half angle of the normal cone; cosangle is -1 if the cone
+		//   is 90 degrees or wider and the cluster faces every viewpoint
+		float sinangle;
+		float cosangle;
+	};
+	struct CullStats
+	{
+		CullStats(void);
+		int nclusters;
+		int nfrustumculled;
+		int nbackfaceculled;
+		long long ntriangles;
+		long long ndrawntriangles;
+	};
+	// Orders the faces and computes the bounds from the points and the face
+	//   normals.
+	void Build(const Mesh & mesh);
+	// Computes the bounds again after the points or normals changed.
+	void UpdateBounds(const Mesh & mesh);
+	void Clear(void);
+	int NClusters(void) const;
+	// Fills ranges with the first triangle and the triangle count of runs of
+	//   clusters that may be visible, adjacent ones merged. The matrices are
+	//   column-major as CameraMath builds them, and modelview is a rotation
+	//   and a translation. With backfaces, the clusters whose faces all face
+	//   away from the eye are culled as well; that is only right where the
+	//   back sides are never seen, as on a closed mesh viewed from outside.
+	//   The test is skipped for a cluster whose sphere holds the eye, and for
+	//   all of them once the near plane cuts into the box around the
+	//   clusters, as it does with the eye inside the mesh.
+	void Cull(const double* modelview, const double* projection, const bool & backfaces, std::vector<std::pair<int, int>> & ranges, CullStats & stats) const;
+
+	static const int clustersize = 256;
+	// the live faces in cluster order; cluster c is the faces from
+	//   c * clustersize up to the next cluster
+	std::vector<int> faces;
+	std::vector<Bounds> bounds;
+	// the box around the spheres of all clusters
+	float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	float bmax[3] = { 0.0f, 0.0f, 0.0f };
+};
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <tuple>
+#include "MeshCompactor.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Numbers the kept elements of [0, n) in order, followed by the removed
+	//   ones in order, and returns the number of kept elements.
+	template <typename Kept>
+	int Rank(int n, const Kept & kept, std::vector<int> & map)
+	{
+		const int blocksize = ThreadPool::blocksize;
+		std::vector<int> keptbefore((n + blocksize - 1) / blocksize + 1, 0);
+		map.resize(n);
+		ThreadPool::Global().ParallelBlocks(n, true, [&](int b, int begin, int end)
+		{
+			int count = 0;
+			for (int i = begin; i < end; ++i)
+			{
+				if (kept(i)) ++count;
+			}
+			keptbefore[b + 1] = count;
+		});
+		for (size_t b = 1; b < keptbefore.size(); ++b) keptbefore[b] += keptbefore[b - 1];
+		const int nkept = keptbefore.back();
+		ThreadPool::Global().ParallelBlocks(n, true, [&](int b, int begin, int end)
+		{
+			int k = keptbefore[b];
+			int r = nkept + begin - keptbefore[b];
+			for (int i = begin; i < end; ++i)
+			{
+				map[i] = kept(i) ? k++ : r++;
+			}
+		});
+		return nkept;
+	}
+
+	template <typename Iterator>
+	void Collect(Iterator begin, Iterator end, std::vector<OpenMesh::BaseProperty*> & properties)
+	{
+		for (auto it = begin; it != end; ++it)
+		{
+			if (*it) properties.push_back(*it);
+		}
+	}
+}
+
+Mesh::VertexHandle MeshCompactor::Remap::Map(const Mesh::VertexHandle & vh) const
+{
+	return Mesh::VertexHandle(vh.is_valid() ? vertices[vh.idx()] : -1);
+}
+
+Mesh::HalfedgeHandle MeshCompactor::Remap::Map(const Mesh::HalfedgeHandle & heh) const
+{
+	return Mesh::HalfedgeHandle(heh.is_valid() ? halfedges[heh.idx()] : -1);
+}
+
+Mesh::EdgeHandle MeshCompactor::Remap::Map(const Mesh::EdgeHandle & eh) const
+{
+	return Mesh::EdgeHandle(eh.is_valid() ? edges[eh.idx()] : -1);
+}
+
+Mesh::FaceHandle MeshCompactor::Remap::Map(const Mesh::FaceHandle & fh) const
+{
+	return Mesh::FaceHandle(fh.is_valid() ? faces[fh.idx()] : -1);
+}
+
+void MeshCompactor::Compact(Mesh & mesh, Remap* remap)
+{
+	// vertices and faces keep their order
+	std::vector<int> vertexmap, facemap;
+	const int nvkept = Rank(static_cast<int>(mesh.n_vertices()), [&](int i) { return !mesh.status(Mesh::VertexHandle(i)).deleted(); }, vertexmap);
+	const int nfkept = Rank(static_cast<int>(mesh.n_faces()), [&](int i) { return !mesh.status(Mesh::FaceHandle(i)).deleted(); }, facemap);
+	Apply(mesh, vertexmap, nvkept, facemap, nfkept, remap);
+}
+
+void MeshCompactor::Renumber(Mesh & mesh, std::vector<int> vertexmap, std::vector<int> facemap, Remap* remap)
+{
+	int nvkept = 0, nfkept = 0;
+	for (int v = 0; v < static_cast<int>(mesh.n_vertices()); ++v)
+	{
+		if (!mesh.status(Mesh::VertexHandle(v)).deleted()) ++nvkept;
+	}
+	for (int f = 0; f < static_cast<int>(mesh.n_faces()); ++f)
+	{
+		if (!mesh.status(Mesh::FaceHandle(f)).deleted()) ++nfkept;
+	}
+	Apply(mesh, vertexmap, nvkept, facemap, nfkept, remap);
+}
+
+void MeshCompactor::Apply(Mesh & mesh, std::vector<int> & vertexmap, int nvkept, std::vector<int> & facemap, int nfkept, Remap* remap)
+{
+	const int nv = static_cast<int>(mesh.n_vertices());
+	const int ne = static_cast<int>(mesh.n_edges());
+	const int nf = static_cast<int>(mesh.n_faces());
+	const int nh = 2 * ne;
+	std::vector<int> faceorder(nfkept);
+	ThreadPool::Global().ParallelBlocks(nf, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			if (facemap[f] < nfkept) faceorder[facemap[f]] = f;
+		}
+	});
+
+	// Reassign lists the vertices of a face from the target of its halfedge
+	//   on, so corner i is the halfedge after the face's own halfedge, which
+	//   comes last
+	std::vector<int> position(nh, -1);
+	ThreadPool::Global().ParallelBlocks(nf, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			Mesh::FaceHandle fh(f);
+			if (mesh.status(fh).deleted()) continue;
+			auto h0 = mesh.halfedge_handle(fh);
+			int k = 0;
+			for (auto h = mesh.next_halfedge_handle(h0); h != h0; h = mesh.next_halfedge_handle(h))
+			{
+				position[h.idx()] = k++;
+			}
+			position[h0.idx()] = k;
+		}
+	});
+
+	// edges in the order of their first corner; flip marks the edges whose
+	//   first corner is halfedge 1
+	std::vector<int> edgemap(ne, -1);
+	std::vector<char> flip(ne, 0);
+	int nekept = 0;
+	for (int f : faceorder)
+	{
+		Mesh::FaceHandle fh(f);
+		auto h0 = mesh.halfedge_handle(fh);
+		auto h = h0;
+		do
+		{
+			h = mesh.next_halfedge_handle(h);
+			int e = h.idx() >> 1;
+			if (edgemap[e] < 0)
+			{
+				edgemap[e] = nekept++;
+				flip[e] = h.idx() & 1;
+			}
+		} while (h != h0);
+	}
+	for (int e = 0; e < ne; ++e)
+	{
+		if (edgemap[e] < 0 && !mesh.status(Mesh::EdgeHandle(e)).deleted()) edgemap[e] = nekept++;
+	}
+	for (int e = 0, removed = nekept; e < ne; ++e)
+	{
+		if (edgemap[e] < 0) edgemap[e] = removed++;
+	}
+	auto hmap = [&](Mesh::HalfedgeHandle h)
+	{
+		int e = h.idx() >> 1;
+		return 2 * edgemap[e] + ((h.idx() & 1) ^ flip[e]);
+	};
+
+	// the connectivity of the compacted mesh, read before anything moves
+	std::vector<int> vertexhalfedge(nvkept, -1), facehalfedge(nfkept);
+	std::vector<int> halfedgevertex(2 * nekept), halfedgeface(2 * nekept), halfedgenext(2 * nekept);
+	ThreadPool::Global().ParallelBlocks(nv, true, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			Mesh::VertexHandle vh(v);
+			if (vertexmap[v] >= nvkept || !mesh.halfedge_handle(vh).is_valid()) continue;
+			// add_face leaves a boundary vertex at the boundary halfedge before
+			//   the corner with the smallest (target, face, position), and an
+			//   inner vertex at its first corner
+			std::tuple<int, int, int> bestboundary(nvkept, 0, 0), bestinner(nfkept, 0, 0);
+			Mesh::HalfedgeHandle boundary, inner;
+			for (const auto & h : mesh.voh_range(vh))
+			{
+				auto fh = mesh.face_handle(h);
+				if (!fh.is_valid()) continue;
+				std::tuple<int, int, int> corner(facemap[fh.idx()], position[h.idx()], 0);
+				if (corner < bestinner)
+				{
+					bestinner = corner;
+					inner = h;
+				}
+				auto out = mesh.opposite_halfedge_handle(mesh.prev_halfedge_handle(h));
+				if (!mesh.is_boundary(out)) continue;
+				std::tuple<int, int, int> key(vertexmap[mesh.to_vertex_handle(h).idx()], facemap[fh.idx()], position[h.idx()]);
+				if (key < bestboundary)
+				{
+					bestboundary = key;
+					boundary = out;
+				}
+			}
+			auto heh = boundary.is_valid() ? boundary : inner.is_valid() ? inner : mesh.halfedge_handle(vh);
+			vertexhalfedge[vertexmap[v]] = hmap(heh);
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(nf, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			if (facemap[f] >= nfkept) continue;
+			facehalfedge[facemap[f]] = hmap(mesh.halfedge_handle(Mesh::FaceHandle(f)));
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(nh, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::HalfedgeHandle h(i);
+			if (edgemap[i >> 1] >= nekept) continue;
+			int n = hmap(h);
+			auto fh = mesh.face_handle(h);
+			halfedgevertex[n] = vertexmap[mesh.to_vertex_handle(h).idx()];
+			halfedgeface[n] = fh.is_valid() ? facemap[fh.idx()] : -1;
+			halfedgenext[n] = hmap(mesh.next_halfedge_handle(h));
+		}
+	});
+
+	// move the property values, then cut off the removed elements
+	std::vector<int> halfedgemap(nh);
+	for (int i = 0; i < nh; ++i)
+	{
+		halfedgemap[i] = hmap(Mesh::HalfedgeHandle(i));
+	}
+	std::vector<OpenMesh::BaseProperty*> properties;
+	Collect(mesh.vprops_begin(), mesh.vprops_end(), properties);
+	Permute(properties, vertexmap);
+	properties.clear();
+	Collect(mesh.hprops_begin(), mesh.hprops_end(), properties);
+	Permute(properties, halfedgemap);
+	properties.clear();
+	Collect(mesh.eprops_begin(), mesh.eprops_end(), properties);
+	Permute(properties, edgemap);
+	properties.clear();
+	Collect(mesh.fprops_begin(), mesh.fprops_end(), properties);
+	Permute(properties, facemap);
+	mesh.resize(nvkept, nekept, nfkept);
+
+	ThreadPool::Global().ParallelBlocks(nvkept, true, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			mesh.set_halfedge_handle(Mesh::VertexHandle(v), Mesh::HalfedgeHandle(vertexhalfedge[v]));
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(nfkept, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			mesh.set_halfedge_handle(Mesh::FaceHandle(f), Mesh::HalfedgeHandle(facehalfedge[f]));
+		}
+	});
+	// next is a permutation, so every halfedge is the prev of exactly one other
+	ThreadPool::Global().ParallelBlocks(2 * nekept, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::HalfedgeHandle h(i);
+			mesh.set_vertex_handle(h, Mesh::VertexHandle(halfedgevertex[i]));
+			mesh.set_face_handle(h, Mesh::FaceHandle(halfedgeface[i]));
+			mesh.set_next_halfedge_handle(h, Mesh::HalfedgeHandle(halfedgenext[i]));
+		}
+	});
+
+	if (remap)
+	{
+		auto removed = [](std::vector<int> & map, int nkept)
+		{
+			for (auto & i : map)
+			{
+				if (i >= nkept) i = -1;
+			}
+		};
+		remap->vertices.swap(vertexmap);
+		remap->halfedges.swap(halfedgemap);
+		remap->edges.swap(edgemap);
+		remap->faces.swap(facemap);
+		removed(remap->vertices, nvkept);
+		removed(remap->halfedges, 2 * nekept);
+		removed(remap->edges, nekept);
+		removed(remap->faces, nfkept);
+	}
+	MeshTools::Modified(mesh);
+}
+
+void MeshCompactor::Permute(std::vector<OpenMesh::BaseProperty*> & properties, const std::vector<int> & perm)
+{
+	// one property per task; each follows the cycles of perm with swaps
+	ThreadPool::Global().ParallelFor(static_cast<int>(properties.size()), [&](int p)
+	{
+		std::vector<int> target(perm);
+		for (int i = 0; i < static_cast<int>(target.size()); ++i)
+		{
+			while (target[i] != i)
+			{
+				int j = target[i];
+				properties[p]->swap(i, j);
+				std::swap(target[i], target[j]);
+			}
+		}
+	});
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "MeshDefinition.h"
+
+// Removes the deleted elements of a mesh in place and numbers the others the
+//   way a mesh read from an OBJ file is numbered: vertices and faces keep their
+//   relative order, and edges are numbered by their first halfedge in face
+//   order, halfedge 2e running along it, as add_face does. Vertex and face
+//   halfedge handles are chosen like add_face chooses them, so the result is
+//   the one MeshTools::Reassign used to build from scratch. The exceptions are
+//   vertices with more than one boundary gap, whose boundary links are kept
+//   as they are. Edges without faces are kept after all the others.
+//
+//   Elements are moved by swapping them in every property, so custom
+//   properties move along. Runs in O(V + E + F) time with a few int arrays
+//   besides the mesh.
+class MeshCompactor
+{
+public:
+	// old index -> new index, -1 for removed elements, to update the handles
+	//   a caller keeps across the compaction
+	struct Remap
+	{
+		std::vector<int> vertices;
+		std::vector<int> halfedges;
+		std::vector<int> edges;
+		std::vector<int> faces;
+		Mesh::VertexHandle Map(const Mesh::VertexHandle & vh) const;
+		Mesh::HalfedgeHandle Map(const Mesh::HalfedgeHandle & heh) const;
+		Mesh::EdgeHandle Map(const Mesh::EdgeHandle & eh) const;
+		Mesh::FaceHandle Map(const Mesh::FaceHandle & fh) const;
+	};
+	static void Compact(Mesh & mesh, Remap* remap = nullptr);
+	// Compact, but with the kept vertices and faces in a given order instead
+	//   of their own: old index -> new index, a permutation that numbers the
+	//   kept elements first. Edges and halfedge handles follow the new face
+	//   order as above.
+	static void Renumber(Mesh & mesh, std::vector<int> vertexmap, std::vector<int> facemap, Remap* remap = nullptr);
+private:
+	static void Apply(Mesh & mesh, std::vector<int> & vertexmap, int nvkept, std::vector<int> & facemap, int nfkept, Remap* remap);
+	// moves element i of every property to perm[i]
+	static void Permute(std::vector<OpenMesh::BaseProperty*> & properties, const std::vector<int> & perm);
+};
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "MeshComponents.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// the face of heh, or the one across it if heh is a boundary halfedge; the
+	//   halfedge of a boundary vertex is a boundary one
+	Mesh::FaceHandle EdgeFace(const Mesh & mesh, const Mesh::HalfedgeHandle & heh)
+	{
+		auto fh = mesh.face_handle(heh);
+		return fh.is_valid() ? fh : mesh.face_handle(mesh.opposite_halfedge_handle(heh));
+	}
+}
+
+// with path halving; a concurrent union may move roots below others, but
+//   every parent stays an ancestor, so the walk still ends at a root
+int MeshComponents::Find(std::atomic<int>* parent, int i)
+{
+	while (true)
+	{
+		int p = parent[i].load(std::memory_order_relaxed);
+		if (p == i) return i;
+		int gp = parent[p].load(std::memory_order_relaxed);
+		if (p != gp) parent[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+		i = gp;
+	}
+}
+
+void MeshComponents::Unite(std::atomic<int>* parent, int a, int b)
+{
+	while (true)
+	{
+		a = Find(parent, a);
+		b = Find(parent, b);
+		if (a == b) return;
+		if (a < b) std::swap(a, b);
+		// a is the larger root; it fails to link if a union made it a child
+		int expected = a;
+		if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+	}
+}
+
+int MeshComponents::Label(const Mesh & mesh, std::vector<int> & vertexcomponent, std::vector<int> & facecomponent, const bool & parallel)
+{
+	int nv = static_cast<int>(mesh.n_vertices());
+	int ne = static_cast<int>(mesh.n_edges());
+	int nf = static_cast<int>(mesh.n_faces());
+	std::unique_ptr<std::atomic<int>[]> parent(new std::atomic<int>[nf]);
+	ThreadPool::Global().ParallelBlocks(nf, parallel, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f) parent[f].store(f, std::memory_order_relaxed);
+	});
+	// faces are joined across edges only, as ff_range joins them, so faces
+	//   that share just a vertex stay apart
+	ThreadPool::Global().ParallelBlocks(ne, parallel, [&](int, int begin, int end)
+	{
+		for (int e = begin; e < end; ++e)
+		{
+			Mesh::EdgeHandle eh(e);
+			if (mesh.status(eh).deleted() || mesh.is_boundary(eh)) continue;
+			Unite(parent.get(), mesh.face_handle(mesh.halfedge_handle(eh, 0)).idx(), mesh.face_handle(mesh.halfedge_handle(eh, 1)).idx());
+		}
+	});
+
+	int ncomponents = Number(parent.get(), nf, [&](int f) { return mesh.status(Mesh::FaceHandle(f)).deleted(); }, facecomponent, parallel);
+	vertexcomponent.assign(nv, -1);
+	ThreadPool::Global().ParallelBlocks(nv, parallel, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			Mesh::VertexHandle vh(v);
+			if (mesh.status(vh).deleted() || !mesh.halfedge_handle(vh).is_valid()) continue;
+			vertexcomponent[v] = facecomponent[EdgeFace(mesh, mesh.halfedge_handle(vh)).idx()];
+		}
+	});
+	return ncomponents;
+}
+
+void MeshComponents::RootOffsets(std::atomic<int>* parent, int n, const std::function<bool(int)> & skip, const bool & parallel, std::vector<int> & blockstart)
+{
+	const int blocksize = ThreadPool::blocksize;
+	blockstart.assign((n + blocksize - 1) / blocksize + 1, 0);
+	ThreadPool::Global().ParallelBlocks(n, parallel, [&](int b, int begin, int end)
+	{
+		int nroots = 0;
+		for (int i = begin; i < end; ++i)
+		{
+			if (!skip(i) && Find(parent, i) == i) ++nroots;
+		}
+		blockstart[b + 1] = nroots;
+	});
+	for (size_t b = 1; b < blockstart.size(); ++b) blockstart[b] += blockstart[b - 1];
+}
+
+int MeshComponents::Count(std::atomic<int>* parent, int n, const std::function<bool(int)> & skip, const bool & parallel)
+{
+	std::vector<int> blockstart;
+	RootOffsets(parent, n, skip, parallel, blockstart);
+	return blockstart.back();
+}
+
+int MeshComponents::Number(std::atomic<int>* parent, int n, const std::function<bool(int)> & skip, std::vector<int> & label, const bool & parallel)
+{
+	// count the roots per block, then number them from the block's offset
+	std::vector<int> blockstart;
+	RootOffsets(parent, n, skip, parallel, blockstart);
+	label.assign(n, -1);
+	ThreadPool::Global().ParallelBlocks(n, parallel, [&](int b, int begin, int end)
+	{
+		int id = blockstart[b];
+		for (int i = begin; i < end; ++i)
+		{
+			if (!skip(i) && Find(parent, i) == i) label[i] = id++;
+		}
+	});
+	// the roots are labelled now and are not written again
+	ThreadPool::Global().ParallelBlocks(n, parallel, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (skip(i)) continue;
+			int root = Find(parent, i);
+			if (root != i) label[i] = label[root];
+		}
+	});
+	return blockstart.back();
+}
+
+void MeshComponents::Analyze(const Mesh & mesh, const std::vector<int> & facecomponent, const int & ncomponents, std::vector<Component> & components)
+{
+	// integer counts, so the order does not matter; one serial sweep per array
+	components.assign(ncomponents, Component{ 0, 0, 0, 0, 0, 0 });
+	// both faces of an edge are in the component of the edge
+	auto component = [&](const Mesh::HalfedgeHandle & heh) { return facecomponent[EdgeFace(mesh, heh).idx()]; };
+	std::vector<int> seen;
+	for (const auto & vh : mesh.vertices())
+	{
+		auto heh = mesh.halfedge_handle(vh);
+		if (!heh.is_valid()) continue;
+		if (!mesh.is_boundary(heh))
+		{
+			++components[component(heh)].nvertices;
+			continue;
+		}
+		// a vertex where fans of different components meet is in each of them
+		seen.clear();
+		for (const auto & voh : mesh.voh_range(vh))
+		{
+			int c = component(voh);
+			if (std::find(seen.begin(), seen.end(), c) != seen.end()) continue;
+			seen.push_back(c);
+			++components[c].nvertices;
+		}
+	}
+	for (const auto & eh : mesh.edges())
+	{
+		++components[component(mesh.halfedge_handle(eh, 0))].nedges;
+	}
+	for (const auto & fh : mesh.faces())
+	{
+		++components[facecomponent[fh.idx()]].nfaces;
+	}
+	// a boundary cycle runs through every component it meets at a vertex,
+	//   and each run of it in one component is a loop of that component
+	std::vector<char> visited(mesh.n_halfedges(), 0);
+	for (const auto & heh : mesh.halfedges())
+	{
+		if (visited[heh.idx()] || !mesh.is_boundary(heh)) continue;
+		int nruns = 0;
+		auto h = heh;
+		do
+		{
+			visited[h.idx()] = 1;
+			auto next = mesh.next_halfedge_handle(h);
+			if (component(next) != component(h))
+			{
+				++components[component(next)].nboundaryloops;
+				++nruns;
+			}
+			h = next;
+		} while (h != heh && !visited[h.idx()]);
+		if (nruns == 0) ++components[component(heh)].nboundaryloops;
+	}
+	for (auto & c : components)
+	{
+		c.euler = c.nvertices - c.nedges + c.nfaces;
+		c.genus = (2 - c.nboundaryloops - c.euler) / 2;
+	}
+}
+
+int MeshComponents::Components(const Mesh & mesh, std::vector<Component> & components, const bool & parallel)
+{
+	std::vector<int> vertexcomponent, facecomponent;
+	int ncomponents = Label(mesh, vertexcomponent, facecomponent, parallel);
+	Analyze(mesh, facecomponent, ncomponents, components);
+	return ncomponents;
+}
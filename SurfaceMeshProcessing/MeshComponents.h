@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "MeshDefinition.h"
+
+// Connected components of a mesh, found with a concurrent union-find over the
+//   faces joined across their edges. A union always links the larger root
+//   below the smaller one, so every component ends up rooted at its smallest
+//   face whatever the order the threads ran in, and components are numbered
+//   by that face. Faces that share only a vertex are in different components,
+//   as with ff_range; such a vertex is labelled with one of them, but Analyze
+//   counts it in each. Deleted faces and deleted and isolated vertices get the
+//   label -1.
+class MeshComponents
+{
+public:
+	struct Component
+	{
+		long long nvertices;
+		long long nedges;
+		long long nfaces;
+		long long nboundaryloops;
+		// V - E + F and, for an orientable surface, (2 - boundary loops - euler) / 2
+		long long euler;
+		long long genus;
+	};
+	// returns the number of components
+	static int Label(const Mesh & mesh, std::vector<int> & vertexcomponent, std::vector<int> & facecomponent, const bool & parallel = true);
+	static void Analyze(const Mesh & mesh, const std::vector<int> & facecomponent, const int & ncomponents, std::vector<Component> & components);
+	// Label followed by Analyze
+	static int Components(const Mesh & mesh, std::vector<Component> & components, const bool & parallel = true);
+	// The union-find behind Label, safe to call from several threads at once
+	//   on parent[i] = i for all i to start with; after the unions, the root
+	//   of a set is its smallest element.
+	static int Find(std::atomic<int>* parent, int i);
+	static void Unite(std::atomic<int>* parent, int a, int b);
+	// Once the unions are done: Count returns the number of roots among the
+	//   n elements, leaving out those skip is true for, and Number also
+	//   numbers the roots 0, 1, ... in index order and gives every element
+	//   the number of its root, -1 if skipped. MeshStats, Label and
+	//   MeshAdjacency::Components count their components with these.
+	static int Count(std::atomic<int>* parent, int n, const std::function<bool(int)> & skip, const bool & parallel = true);
+	static int Number(std::atomic<int>* parent, int n, const std::function<bool(int)> & skip, std::vector<int> & label, const bool & parallel = true);
+private:
+	// the roots per block of ThreadPool::blocksize elements, summed up to
+	//   the start of each block; the last entry is the total
+	static void RootOffsets(std::atomic<int>* parent, int n, const std::function<bool(int)> & skip, const bool & parallel, std::vector<int> & blockstart);
+};
@@ -1,11 +1,22 @@
 #include <OpenMesh/Core/IO/MeshIO.hh>
 #include "MeshDefinition.h"
-#include <queue>
+#include "MappedFile.h"
+#include "OBJParser.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "OBJWriter.h"
+#include "MeshReduction.h"
+#include "MeshComponents.h"
+#include "MeshCompactor.h"
 #include <iostream>
 #include <fstream>
 #include <cctype>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <filesystem>
 
-bool MeshTools::ReadMesh(Mesh & mesh, const std::string & filename)
+bool MeshTools::ReadMesh(Mesh & mesh, const std::string & filename, const OBJReader & reader, const bool & usecache, LoadProgress* progress)
 {
 	std::string path(".");
 	auto slash = filename.find_last_of('/');
@@ -33,16 +44,65 @@ bool MeshTools::ReadMesh(Mesh & mesh, const std::string & filename)
 		ext = basename.substr(point + 1);
 		basename = basename.substr(0, point);
 	}
-	std::transform(ext.begin(), ext.end(), ext.begin(), std::tolower);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (ext == "smc")
+	{
+		return MeshCache::Read(mesh, filename, "", progress);
+	}
+	std::string cachename = MeshCache::CacheName(filename);
+	if (usecache)
+	{
+		if (MeshCache::Read(mesh, cachename, filename, progress))
+		{
+			std::cout << "  Loaded cached mesh " << cachename << std::endl;
+			return true;
+		}
+		if (progress)
+		{
+			if (progress->cancelled) return false;
+			// the source is read from the start
+			progress->bytesparsed = 0;
+			progress->bytestotal = 0;
+			progress->facesbuilt = 0;
+			progress->facestotal = 0;
+		}
+	}
+
+	bool read_OK = false;
 	if (ext == "obj")
 	{
-		return ReadOBJ(mesh, path + "/" + basename + "." + ext);
+		switch (reader)
+		{
+		case OBJ_STREAM:
+			read_OK = ReadOBJ(mesh, path + "/" + basename + "." + ext);
+			break;
+		case OBJ_MAPPED:
+			read_OK = ReadOBJMapped(mesh, path + "/" + basename + "." + ext, progress);
+			break;
+		case OBJ_PARALLEL:
+		default:
+			read_OK = ReadOBJParallel(mesh, path + "/" + basename + "." + ext, progress);
+			break;
+		}
 	}
 	else
 	{
 		//std::cout << "Error: the file extension " << ext << " is not supported." << std::endl;
-		return OpenMesh::IO::read_mesh(mesh, filename);
+		read_OK = OpenMesh::IO::read_mesh(mesh, filename);
 	}
+
+	if (!read_OK) return false;
+	// the cache keeps the normals, so a load from it needs no update_normals
+	mesh.update_normals();
+	Modified(mesh);
+	if (usecache)
+	{
+		if (!MeshCache::Write(mesh, cachename, filename))
+		{
+			std::cerr << "  Warning! Could not write mesh cache " << cachename << std::endl;
+		}
+	}
+	return true;
 }
 
 bool MeshTools::ReadOBJ(Mesh & mesh, const std::string & filename)
@@ -219,9 +279,49 @@ bool MeshTools::ReadOBJ(Mesh & mesh, const std::string & filename)
 		}
 	}
 	ifs.close();
+	Modified(mesh);
 	return true;
 }
 
+namespace
+{
+	bool ReadMappedOBJ(Mesh & mesh, const std::string & filename, bool parallel, LoadProgress* progress)
+	{
+		auto start = std::chrono::steady_clock::now();
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			std::cerr << "Error: cannot open file " << filename << std::endl;
+			return false;
+		}
+		if (progress) progress->bytestotal = file.Size();
+		OBJData data;
+		bool parse_OK = parallel ?
+			OBJParser::ParseParallel(file.Data(), file.Data() + file.Size(), data, progress) :
+			OBJParser::Parse(file.Data(), file.Data() + file.Size(), data, progress);
+		if (!parse_OK) return false;
+		auto parsed = std::chrono::steady_clock::now();
+		if (!MeshBuilder::Build(mesh, data.points, data.faceindices, data.faceoffsets, progress)) return false;
+		auto built = std::chrono::steady_clock::now();
+
+		double parsetime = std::chrono::duration<double>(parsed - start).count();
+		double buildtime = std::chrono::duration<double>(built - parsed).count();
+		std::cout << "  Parsed " << file.Size() << " bytes in " << parsetime << " s ("
+			<< (parsetime > 0.0 ? file.Size() / parsetime / 1.0e6 : 0.0) << " MB/s), built mesh in " << buildtime << " s\n";
+		return true;
+	}
+}
+
+bool MeshTools::ReadOBJMapped(Mesh & mesh, const std::string & filename, LoadProgress* progress)
+{
+	return ReadMappedOBJ(mesh, filename, false, progress);
+}
+
+bool MeshTools::ReadOBJParallel(Mesh & mesh, const std::string & filename, LoadProgress* progress)
+{
+	return ReadMappedOBJ(mesh, filename, true, progress);
+}
+
 bool MeshTools::WriteMesh(const Mesh & mesh, const std::string & filename, const std::streamsize & precision)
 {
 	std::string path(".");
@@ -250,10 +350,14 @@ bool MeshTools::WriteMesh(const Mesh & mesh, const std::string & filename, const
 		ext = basename.substr(point + 1);
 		basename = basename.substr(0, point);
 	}
-	std::transform(ext.begin(), ext.end(), ext.begin(), std::tolower);
-	if (ext == "obj")
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (ext == "smc")
+	{
+		return MeshCache::Write(mesh, filename);
+	}
+	else if (ext == "obj")
 	{
-		return WriteOBJ(mesh, path + "/" + basename + "." + ext, precision);
+		return WriteOBJFast(mesh, path + "/" + basename + "." + ext, precision);
 	}
 	else
 	{
@@ -288,30 +392,33 @@ bool MeshTools::WriteOBJ(const Mesh & mesh, const std::string & filename, const
 	return true;
 }
 
-double MeshTools::Area(const Mesh & mesh)
+bool MeshTools::WriteOBJFast(const Mesh & mesh, const std::string & filename, const std::streamsize & precision, const bool & parallel)
 {
-	double area = 0.0;
-	for (const auto & f : mesh.faces())
+	auto start = std::chrono::steady_clock::now();
+	if (!OBJWriter::Write(mesh, filename, static_cast<int>(precision), parallel))
 	{
-		auto heh = mesh.halfedge_handle(f);
-		const auto & p0 = mesh.point(mesh.from_vertex_handle(heh));
-		const auto & p1 = mesh.point(mesh.to_vertex_handle(heh));
-		const auto & p2 = mesh.point(mesh.to_vertex_handle(mesh.next_halfedge_handle(heh)));
-		area += 0.5 * ((p1 - p0) % (p2 - p0)).norm();
+		return false;
+	}
+	double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::error_code ec;
+	auto size = std::filesystem::file_size(filename, ec);
+	if (!ec)
+	{
+		std::cout << "  Wrote " << size << " bytes in " << time << " s ("
+			<< (time > 0.0 ? size / time / 1.0e6 : 0.0) << " MB/s)\n";
 	}
-	return area;
+	return true;
 }
 
-double MeshTools::AverageEdgeLength(const Mesh & mesh)
+double MeshTools::Area(const Mesh & mesh, const bool & parallel)
+{
+	return MeshReduction::Area(mesh, parallel);
+}
+
+double MeshTools::AverageEdgeLength(const Mesh & mesh, const bool & parallel)
 {
 	if (mesh.edges_empty()) return 0.0;
-	double l = 0.0;
-	for (const auto & eh : mesh.edges())
-	{
-		l += mesh.calc_edge_length(eh);
-	}
-	l /= mesh.n_edges();
-	return l;
+	return MeshReduction::EdgeLengthSum(mesh, parallel) / mesh.n_edges();
 }
 
 bool MeshTools::HasBoundary(const Mesh & mesh)
@@ -330,67 +437,54 @@ bool MeshTools::HasBoundary(const Mesh & mesh)
 bool MeshTools::HasOneComponent(const Mesh & mesh)
 {
 	if (mesh.faces_empty()) return false;
-	std::vector<int> visit(mesh.n_faces(), 0);
-	visit[0] = 1;
-	std::queue<int> q;
-	q.push(0);
-	while (!q.empty())
-	{
-		int fid = q.front();
-		q.pop();
-		for (const auto & ffh : mesh.ff_range(mesh.face_handle(fid)))
-		{
-			if (!visit[ffh.idx()])
-			{
-				visit[ffh.idx()] = 1;
-				q.push(ffh.idx());
-			}
-		}
-	}
-	for (const auto & v : visit)
-	{
-		if (!v)
-		{
-			return false;
-		}
-	}
-	return true;
+	std::vector<int> vertexcomponent, facecomponent;
+	return MeshComponents::Label(mesh, vertexcomponent, facecomponent) == 1;
 }
 
 int MeshTools::Genus(const Mesh & mesh)
 {
-	if (HasBoundary(mesh) || !HasOneComponent(mesh)) return -1;
-	return 1 - ((int)mesh.n_vertices() + (int)mesh.n_faces() - (int)mesh.n_edges()) / 2;
+	std::vector<MeshComponents::Component> components;
+	if (MeshComponents::Components(mesh, components) != 1 || components[0].nboundaryloops > 0) return -1;
+	return static_cast<int>(components[0].genus);
 }
 
-void MeshTools::BoundingBox(const Mesh & mesh, Mesh::Point & bmax, Mesh::Point & bmin)
+void MeshTools::BoundingBox(const Mesh & mesh, Mesh::Point & bmax, Mesh::Point & bmin, const bool & parallel)
 {
-	if (mesh.vertices_empty()) return;
-	bmax = bmin = mesh.point(*mesh.vertices_begin());
-	for (const auto vh : mesh.vertices())
-	{
-		bmax.maximize(mesh.point(vh));
-		bmin.minimize(mesh.point(vh));
-	}
+	MeshReduction::BoundingBox(mesh, bmax, bmin, parallel);
 }
 
 // This function should be used after collapse or split, since the indices of
 //   edges may be changed after a local modification. By using this function,
 //   the indices of edges are the same as a mesh loaded from obj files.
+//   mesh2 may be mesh1, which is then compacted in place (see MeshCompactor).
 void MeshTools::Reassign(const Mesh & mesh1, Mesh & mesh2)
 {
-	mesh2.clear();
-	for (const auto & vh : mesh1.vertices())
+	if (&mesh1 != &mesh2)
 	{
-		mesh2.add_vertex(mesh1.point(vh));
+		mesh2 = mesh1;
 	}
-	for (const auto & fh : mesh1.faces())
+	MeshCompactor::Compact(mesh2);
+}
+
+namespace
+{
+	const char* ModificationProperty = "<modification>";
+	// 0 is left for meshes that were never stamped
+	std::atomic<unsigned long long> NextModification(1);
+}
+
+void MeshTools::Modified(Mesh & mesh)
+{
+	OpenMesh::MPropHandleT<unsigned long long> handle;
+	if (!mesh.get_property_handle(handle, ModificationProperty))
 	{
-		std::vector<Mesh::VertexHandle> vhs;
-		for (const auto & fvh : mesh1.fv_range(fh))
-		{
-			vhs.push_back(mesh2.vertex_handle(fvh.idx()));
-		}
-		mesh2.add_face(vhs);
+		mesh.add_property(handle, ModificationProperty);
 	}
+	mesh.property(handle) = NextModification++;
+}
+
+unsigned long long MeshTools::Modification(const Mesh & mesh)
+{
+	OpenMesh::MPropHandleT<unsigned long long> handle;
+	return mesh.get_property_handle(handle, ModificationProperty) ? mesh.property(handle) : 0;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+#include <atomic>
 #ifdef _DEBUG
 #pragma comment(lib, "OpenMeshCored.lib")
 #pragma comment(lib, "OpenMeshToolsd.lib")
@@ -7,30 +8,81 @@
 #pragma comment(lib, "OpenMeshCore.lib")
 #pragma comment(lib, "OpenMeshTools.lib")
 #endif
-struct MeshTraits : public OpenMesh::DefaultTraits
+template <typename Vec>
+struct MeshTraitsT : public OpenMesh::DefaultTraits
 {
-	typedef OpenMesh::Vec3d Point;
-	typedef OpenMesh::Vec3d Normal;
+	typedef Vec Point;
+	typedef Vec Normal;
 	VertexAttributes(OpenMesh::Attributes::Status | OpenMesh::Attributes::Normal);
 	FaceAttributes(OpenMesh::Attributes::Status | OpenMesh::Attributes::Normal);
 	EdgeAttributes(OpenMesh::Attributes::Status);
 	HalfedgeAttributes(OpenMesh::Attributes::Status);
 };
+typedef MeshTraitsT<OpenMesh::Vec3d> MeshTraitsd;
+typedef MeshTraitsT<OpenMesh::Vec3f> MeshTraitsf;
+// Points and normals are double unless SURFACEMESH_FLOAT is defined for the
+//   whole build; float halves their memory and matches what MeshRenderer
+//   uploads. Code that mixes them with doubles uses Mesh::Scalar.
+#ifdef SURFACEMESH_FLOAT
+typedef MeshTraitsf MeshTraits;
+#else
+typedef MeshTraitsd MeshTraits;
+#endif
 typedef OpenMesh::TriMesh_ArrayKernelT<MeshTraits> Mesh;
 
+// Counters a running MeshTools::ReadMesh updates so that another thread can
+//   report its progress. Setting cancelled makes the read stop early and
+//   return false.
+struct LoadProgress
+{
+	LoadProgress(void) : bytesparsed(0), bytestotal(0), facesbuilt(0), facestotal(0), cancelled(false) {}
+	std::atomic<size_t> bytesparsed;
+	std::atomic<size_t> bytestotal;
+	std::atomic<size_t> facesbuilt;
+	std::atomic<size_t> facestotal;
+	std::atomic<bool> cancelled;
+};
+
 class MeshTools
 {
 public:
-	static bool ReadMesh(Mesh & mesh, const std::string & filename);
+	// OBJ_STREAM is the original two-pass std::getline reader (ReadOBJ),
+	//   OBJ_MAPPED parses a memory-mapped file in a single pass (ReadOBJMapped),
+	//   OBJ_PARALLEL parses chunks of the mapped file on all cores (ReadOBJParallel).
+	enum OBJReader { OBJ_STREAM, OBJ_MAPPED, OBJ_PARALLEL };
+	// The mesh comes back with its normals computed. With usecache, a binary
+	//   sidecar (see MeshCache) is written next to the file after a successful
+	//   read and used instead of the file as long as the file's size and
+	//   modification time are unchanged; an .smc file is read as a cache.
+	//   progress, if given, is updated by the mapped OBJ readers and the cache.
+	static bool ReadMesh(Mesh & mesh, const std::string & filename, const OBJReader & reader = OBJ_PARALLEL, const bool & usecache = false, LoadProgress* progress = nullptr);
 	static bool ReadOBJ(Mesh & mesh, const std::string & filename);
+	static bool ReadOBJMapped(Mesh & mesh, const std::string & filename, LoadProgress* progress = nullptr);
+	static bool ReadOBJParallel(Mesh & mesh, const std::string & filename, LoadProgress* progress = nullptr);
 	//static bool ReadOFF(Mesh & mesh, const std::string & filename);
 	static bool WriteMesh(const Mesh & mesh, const std::string & filename, const std::streamsize & precision = 6);
 	static bool WriteOBJ(const Mesh & mesh, const std::string & filename, const std::streamsize & precision = 6);
-	static double Area(const Mesh & mesh);
-	static double AverageEdgeLength(const Mesh & mesh);
+	// buffered std::to_chars writer (see OBJWriter); precision >= 17 writes
+	//   the shortest round-trip representation
+	static bool WriteOBJFast(const Mesh & mesh, const std::string & filename, const std::streamsize & precision = 6, const bool & parallel = true);
+	// Area, AverageEdgeLength and BoundingBox run on the thread pool unless
+	//   parallel is false; both give the same result (see MeshReduction).
+	static double Area(const Mesh & mesh, const bool & parallel = true);
+	static double AverageEdgeLength(const Mesh & mesh, const bool & parallel = true);
 	static bool HasBoundary(const Mesh & mesh);
 	static bool HasOneComponent(const Mesh & mesh);
+	// -1 unless the mesh is closed and has one component; MeshComponents gives
+	//   the genus of every component of any mesh
 	static int Genus(const Mesh & mesh);
-	static void BoundingBox(const Mesh & mesh, Mesh::Point & bmax, Mesh::Point & bmin);
+	static void BoundingBox(const Mesh & mesh, Mesh::Point & bmax, Mesh::Point & bmin, const bool & parallel = true);
 	static void Reassign(const Mesh & mesh1, Mesh & mesh2);
+	// Modified stamps a mesh whose points or elements changed with a number
+	//   no mesh had before, kept in a mesh property, so that results computed
+	//   from it (MeshStats) can tell whether it changed since; Modification
+	//   is 0 for a mesh that was never stamped. The readers, MeshBuilder,
+	//   MeshCache, MeshGenerator, MeshCompactor (and so Reassign and
+	//   MeshReorder) and MeshHistory stamp the meshes they change; other code
+	//   that edits a mesh calls Modified itself.
+	static void Modified(Mesh & mesh);
+	static unsigned long long Modification(const Mesh & mesh);
 };
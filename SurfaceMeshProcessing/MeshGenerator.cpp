@@ -0,0 +1,418 @@
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "MeshGenerator.h"
+#include "MeshBuilder.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+
+	// uniform in [0, 1), depending only on seed and index so that the result
+	//   does not depend on how the work is split between threads
+	double Random(unsigned int seed, uint64_t index)
+	{
+		// splitmix64
+		uint64_t z = (static_cast<uint64_t>(seed) << 32 ^ index) + 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		z ^= z >> 31;
+		return (z >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// Appends room for nvertices points and ntriangles triangles and returns
+	//   the index of the first new point and of the first new triangle.
+	void Append(OBJData & data, long long nvertices, long long ntriangles, int & v0, long long & t0)
+	{
+		v0 = static_cast<int>(data.points.size());
+		t0 = static_cast<long long>(data.faceoffsets.size()) - 1;
+		data.points.resize(v0 + nvertices);
+		data.faceindices.resize(3 * (t0 + ntriangles));
+		data.faceoffsets.resize(t0 + ntriangles + 1);
+		int* offsets = data.faceoffsets.data();
+		ThreadPool::Global().ParallelBlocks(ntriangles, true, [&](int, long long begin, long long end)
+		{
+			for (long long t = t0 + begin; t < t0 + end; ++t)
+			{
+				offsets[t + 1] = static_cast<int>(3 * (t + 1));
+			}
+		});
+	}
+
+	inline void SetTriangle(OBJData & data, long long t, int a, int b, int c)
+	{
+		int* idx = &data.faceindices[3 * t];
+		idx[0] = a;
+		idx[1] = b;
+		idx[2] = c;
+	}
+}
+
+void MeshGenerator::Icosphere(Mesh & mesh, const long long & nfaces, const unsigned int & seed)
+{
+	OBJData data;
+	MakeIcosphere(nfaces, data);
+	Transform(data, 0, 1.0, Mesh::Point(0.0), seed);
+	Build(mesh, data);
+}
+
+void MeshGenerator::Torus(Mesh & mesh, const long long & nfaces, const unsigned int & seed)
+{
+	OBJData data;
+	MakeTorus(nfaces, data);
+	Transform(data, 0, 1.0, Mesh::Point(0.0), seed);
+	Build(mesh, data);
+}
+
+void MeshGenerator::HoleSurface(Mesh & mesh, const int & holes, const long long & nfaces, const unsigned int & seed)
+{
+	OBJData data;
+	MakeHoleSurface(std::max(0, holes), nfaces, data);
+	Transform(data, 0, 1.0, Mesh::Point(0.0), seed);
+	Build(mesh, data);
+}
+
+void MeshGenerator::Grid(Mesh & mesh, const long long & nfaces, const unsigned int & seed)
+{
+	OBJData data;
+	MakeGrid(nfaces, data);
+	Transform(data, 0, 1.0, Mesh::Point(0.0), seed);
+	Build(mesh, data);
+}
+
+void MeshGenerator::Scene(Mesh & mesh, const int & ncomponents, const long long & nfaces, const unsigned int & seed)
+{
+	int n = std::max(1, ncomponents);
+	int side = 1;
+	while (side * side * side < n) ++side;
+	OBJData data;
+	for (int i = 0; i < n; ++i)
+	{
+		size_t begin = data.points.size();
+		if (i % 2 == 0)
+		{
+			MakeIcosphere(nfaces / n, data);
+		}
+		else
+		{
+			MakeTorus(nfaces / n, data);
+		}
+		Mesh::Point offset(3.0 * (i % side), 3.0 * (i / side % side), 3.0 * (i / side / side));
+		Transform(data, begin, 1.0, offset, seed == 0 ? 0 : seed + i);
+	}
+	Build(mesh, data);
+}
+
+void MeshGenerator::AddNoise(Mesh & mesh, const double & amplitude, const unsigned int & seed)
+{
+	double scale = amplitude * MeshTools::AverageEdgeLength(mesh);
+	mesh.update_normals();
+	ThreadPool::Global().ParallelBlocks(static_cast<long long>(mesh.n_vertices()), true, [&](int, long long begin, long long end)
+	{
+		for (long long i = begin; i < end; ++i)
+		{
+			Mesh::VertexHandle vh(static_cast<int>(i));
+			double r = 2.0 * Random(seed, i) - 1.0;
+			mesh.set_point(vh, mesh.point(vh) + mesh.normal(vh) * static_cast<Mesh::Scalar>(r * scale));
+		}
+	});
+	mesh.update_normals();
+	MeshTools::Modified(mesh);
+}
+
+void MeshGenerator::AddDegenerateFaces(Mesh & mesh, const double & fraction, const unsigned int & seed)
+{
+	// in index order, so a vertex may land on a neighbour that was moved before
+	for (const auto & vh : mesh.vertices())
+	{
+		if (Random(seed, vh.idx()) >= fraction) continue;
+		auto heh = mesh.halfedge_handle(vh);
+		if (!heh.is_valid()) continue;
+		mesh.set_point(vh, mesh.point(mesh.to_vertex_handle(heh)));
+	}
+	mesh.update_normals();
+	MeshTools::Modified(mesh);
+}
+
+void MeshGenerator::MakeIcosphere(long long nfaces, OBJData & data)
+{
+	const double t = (1.0 + std::sqrt(5.0)) / 2.0;
+	const Mesh::Point corners[12] = {
+		Mesh::Point(-1, t, 0), Mesh::Point(1, t, 0), Mesh::Point(-1, -t, 0), Mesh::Point(1, -t, 0),
+		Mesh::Point(0, -1, t), Mesh::Point(0, 1, t), Mesh::Point(0, -1, -t), Mesh::Point(0, 1, -t),
+		Mesh::Point(t, 0, -1), Mesh::Point(t, 0, 1), Mesh::Point(-t, 0, -1), Mesh::Point(-t, 0, 1) };
+	const int faces[20][3] = {
+		{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+		{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+		{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+		{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+	// the 30 edges, numbered in order of appearance
+	int edges[30][2];
+	int faceedge[20][3];
+	int nedges = 0;
+	for (int f = 0; f < 20; ++f)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			int u = std::min(faces[f][k], faces[f][(k + 1) % 3]);
+			int v = std::max(faces[f][k], faces[f][(k + 1) % 3]);
+			int e = 0;
+			while (e < nedges && (edges[e][0] != u || edges[e][1] != v)) ++e;
+			if (e == nedges)
+			{
+				edges[e][0] = u;
+				edges[e][1] = v;
+				++nedges;
+			}
+			faceedge[f][k] = e;
+		}
+	}
+
+	const int n = std::max(1, static_cast<int>(std::lround(std::sqrt(nfaces / 20.0))));
+	const long long ninterior = static_cast<long long>(n - 1) * (n - 2) / 2;
+	const long long nvertices = 12 + 30LL * (n - 1) + 20 * ninterior;
+	int v0;
+	long long t0;
+	Append(data, nvertices, 20LL * n * n, v0, t0);
+	Mesh::Point* points = &data.points[v0];
+
+	// vertex k steps from u to v on the edge (u, v)
+	auto edgevertex = [&](int u, int v, int k) -> int
+	{
+		if (k == 0) return u;
+		if (k == n) return v;
+		int e = 0;
+		int lo = std::min(u, v);
+		int hi = std::max(u, v);
+		while (edges[e][0] != lo || edges[e][1] != hi) ++e;
+		return 12 + e * (n - 1) + (u == lo ? k : n - k) - 1;
+	};
+	for (int i = 0; i < 12; ++i)
+	{
+		points[i] = corners[i];
+	}
+	ThreadPool::Global().ParallelFor(30, [&](int e)
+	{
+		for (int k = 1; k < n; ++k)
+		{
+			points[12 + e * (n - 1) + k - 1] = corners[edges[e][0]] + (corners[edges[e][1]] - corners[edges[e][0]]) * (Mesh::Scalar(k) / n);
+		}
+	});
+	// face f is split along rows j = 0..n-1; the point (i, j) is
+	//   A + (B - A) i / n + (C - A) j / n
+	ThreadPool::Global().ParallelFor(20 * n, [&](int task)
+	{
+		int f = task / n;
+		int j = task % n;
+		int a = faces[f][0], b = faces[f][1], c = faces[f][2];
+		long long interiorbase = 12 + 30LL * (n - 1) + f * ninterior;
+		auto vertex = [&](int i, int jj) -> int
+		{
+			if (jj == 0) return edgevertex(a, b, i);
+			if (i == 0) return edgevertex(a, c, jj);
+			if (i + jj == n) return edgevertex(b, c, jj);
+			// rows 1..jj-1 hold n-2, n-3, ... interior points
+			long long before = static_cast<long long>(jj - 1) * (n - 1) - static_cast<long long>(jj - 1) * jj / 2;
+			return static_cast<int>(interiorbase + before + i - 1);
+		};
+		if (j > 0)
+		{
+			for (int i = 1; i + j < n; ++i)
+			{
+				points[vertex(i, j)] = corners[a] + (corners[b] - corners[a]) * (Mesh::Scalar(i) / n) + (corners[c] - corners[a]) * (Mesh::Scalar(j) / n);
+			}
+		}
+		// triangles of row j: n - j pointing up, n - j - 1 pointing down
+		long long t = t0 + static_cast<long long>(f) * n * n + static_cast<long long>(j) * (2 * n - j);
+		for (int i = 0; i + j < n; ++i)
+		{
+			SetTriangle(data, t++, v0 + vertex(i, j), v0 + vertex(i + 1, j), v0 + vertex(i, j + 1));
+			if (i + j + 1 < n)
+			{
+				SetTriangle(data, t++, v0 + vertex(i + 1, j), v0 + vertex(i + 1, j + 1), v0 + vertex(i, j + 1));
+			}
+		}
+	});
+	ThreadPool::Global().ParallelBlocks(nvertices, true, [&](int, long long begin, long long end)
+	{
+		for (long long i = begin; i < end; ++i)
+		{
+			points[i].normalize();
+		}
+	});
+}
+
+void MeshGenerator::MakeTorus(long long nfaces, OBJData & data)
+{
+	// a wrapped grid of nu x nv quads split along one diagonal
+	const double R = 1.0, r = 0.4;
+	int nu = std::max(3, static_cast<int>(std::sqrt(nfaces / 2.0)));
+	int nv = std::max(3, static_cast<int>(nfaces / 2 / nu));
+	int v0;
+	long long t0;
+	Append(data, static_cast<long long>(nu) * nv, 2LL * nu * nv, v0, t0);
+	ThreadPool::Global().ParallelFor(nu, [&](int i)
+	{
+		double u = 2.0 * pi * i / nu;
+		for (int j = 0; j < nv; ++j)
+		{
+			double v = 2.0 * pi * j / nv;
+			data.points[v0 + static_cast<size_t>(i) * nv + j] = Mesh::Point((R + r * std::cos(v)) * std::cos(u), (R + r * std::cos(v)) * std::sin(u), r * std::sin(v));
+			int a = v0 + i * nv + j;
+			int b = v0 + ((i + 1) % nu) * nv + j;
+			int c = v0 + ((i + 1) % nu) * nv + (j + 1) % nv;
+			int d = v0 + i * nv + (j + 1) % nv;
+			long long t = t0 + 2 * (static_cast<long long>(i) * nv + j);
+			SetTriangle(data, t, a, b, c);
+			SetTriangle(data, t + 1, a, c, d);
+		}
+	});
+}
+
+void MeshGenerator::MakeHoleSurface(int holes, long long nfaces, OBJData & data)
+{
+	// Holes sit on a k x k lattice at least three cells apart and two cells
+	//   from the rim, so every cell keeps an unglued vertex and the glued
+	//   surface stays manifold.
+	int k = 0;
+	while (k * k < holes) ++k;
+	int w = std::max(3 * k + 2, static_cast<int>(std::lround(std::sqrt(nfaces / 4.0 + holes))));
+	w = std::max(w, 3);
+	std::vector<char> hole(static_cast<size_t>(w) * w, 0);
+	for (int h = 0; h < holes; ++h)
+	{
+		int a = h % k, b = h / k;
+		int x = k == 1 ? w / 2 : 2 + a * (w - 5) / (k - 1);
+		int y = k == 1 ? w / 2 : 2 + b * (w - 5) / (k - 1);
+		hole[static_cast<size_t>(y) * w + x] = 1;
+	}
+	const int side = w + 1;
+	auto id = [&](int x, int y) { return y * side + x; };
+	// rim and hole corners are shared by both sides
+	std::vector<char> glued(static_cast<size_t>(side) * side, 0);
+	for (int y = 0; y <= w; ++y)
+	{
+		for (int x = 0; x <= w; ++x)
+		{
+			glued[id(x, y)] = x == 0 || y == 0 || x == w || y == w;
+		}
+	}
+	for (int y = 0; y < w; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			if (!hole[static_cast<size_t>(y) * w + x]) continue;
+			glued[id(x, y)] = glued[id(x + 1, y)] = glued[id(x, y + 1)] = glued[id(x + 1, y + 1)] = 1;
+		}
+	}
+	// the bottom copy of vertex v is bottom[v]
+	std::vector<int> bottom(glued.size());
+	int nvertices = static_cast<int>(glued.size());
+	for (size_t v = 0; v < glued.size(); ++v)
+	{
+		bottom[v] = glued[v] ? static_cast<int>(v) : nvertices++;
+	}
+	std::vector<long long> rowstart(w + 1, 0);
+	for (int y = 0; y < w; ++y)
+	{
+		rowstart[y + 1] = rowstart[y];
+		for (int x = 0; x < w; ++x)
+		{
+			if (!hole[static_cast<size_t>(y) * w + x]) rowstart[y + 1] += 4;
+		}
+	}
+	int v0;
+	long long t0;
+	Append(data, nvertices, rowstart[w], v0, t0);
+	const double cell = 2.0 / w;
+	ThreadPool::Global().ParallelFor(side, [&](int y)
+	{
+		for (int x = 0; x <= w; ++x)
+		{
+			int v = id(x, y);
+			Mesh::Point p(-1.0 + x * cell, -1.0 + y * cell, 0.0);
+			data.points[v0 + v] = p;
+			if (!glued[v])
+			{
+				data.points[v0 + v][2] = cell;
+				data.points[v0 + bottom[v]] = Mesh::Point(p[0], p[1], -cell);
+			}
+		}
+	});
+	ThreadPool::Global().ParallelFor(w, [&](int y)
+	{
+		long long t = t0 + rowstart[y];
+		for (int x = 0; x < w; ++x)
+		{
+			if (hole[static_cast<size_t>(y) * w + x]) continue;
+			int c[4] = { id(x, y), id(x + 1, y), id(x + 1, y + 1), id(x, y + 1) };
+			// split along the diagonal through the unglued corner when the
+			//   other three are glued, so no triangle is glued on all sides
+			int nglued = glued[c[0]] + glued[c[1]] + glued[c[2]] + glued[c[3]];
+			int s = nglued == 3 && (!glued[c[1]] || !glued[c[3]]) ? 1 : 0;
+			int a = c[s], b = c[s + 1], d = c[(s + 2) % 4], e = c[(s + 3) % 4];
+			SetTriangle(data, t++, v0 + a, v0 + b, v0 + d);
+			SetTriangle(data, t++, v0 + a, v0 + d, v0 + e);
+			SetTriangle(data, t++, v0 + bottom[a], v0 + bottom[d], v0 + bottom[b]);
+			SetTriangle(data, t++, v0 + bottom[a], v0 + bottom[e], v0 + bottom[d]);
+		}
+	});
+}
+
+void MeshGenerator::MakeGrid(long long nfaces, OBJData & data)
+{
+	int w = std::max(1, static_cast<int>(std::lround(std::sqrt(nfaces / 2.0))));
+	int h = std::max(1, static_cast<int>(nfaces / 2 / w));
+	int v0;
+	long long t0;
+	Append(data, static_cast<long long>(w + 1) * (h + 1), 2LL * w * h, v0, t0);
+	ThreadPool::Global().ParallelFor(h + 1, [&](int y)
+	{
+		for (int x = 0; x <= w; ++x)
+		{
+			data.points[v0 + static_cast<size_t>(y) * (w + 1) + x] = Mesh::Point(-1.0 + 2.0 * x / w, -1.0 + 2.0 * y / h, 0.0);
+			if (y == h || x == w) continue;
+			int a = v0 + y * (w + 1) + x;
+			long long t = t0 + 2 * (static_cast<long long>(y) * w + x);
+			SetTriangle(data, t, a, a + 1, a + w + 2);
+			SetTriangle(data, t + 1, a, a + w + 2, a + w + 1);
+		}
+	});
+}
+
+void MeshGenerator::Transform(OBJData & data, size_t begin, double scale, const Mesh::Point & offset, unsigned int seed)
+{
+	// uniformly distributed rotation (Shoemake) as a unit quaternion
+	double m[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	if (seed != 0)
+	{
+		double u1 = Random(seed, 0), u2 = Random(seed, 1), u3 = Random(seed, 2);
+		double w = std::sqrt(1.0 - u1) * std::sin(2.0 * pi * u2);
+		double x = std::sqrt(1.0 - u1) * std::cos(2.0 * pi * u2);
+		double y = std::sqrt(u1) * std::sin(2.0 * pi * u3);
+		double z = std::sqrt(u1) * std::cos(2.0 * pi * u3);
+		double r[3][3] = {
+			{ 1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y) },
+			{ 2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x) },
+			{ 2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y) } };
+		std::copy(&r[0][0], &r[0][0] + 9, &m[0][0]);
+	}
+	ThreadPool::Global().ParallelBlocks(static_cast<long long>(data.points.size() - begin), true, [&](int, long long b, long long e)
+	{
+		for (long long i = b; i < e; ++i)
+		{
+			Mesh::Point & p = data.points[begin + i];
+			Mesh::Point q(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2],
+				m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2],
+				m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2]);
+			p = q * static_cast<Mesh::Scalar>(scale) + offset;
+		}
+	});
+}
+
+void MeshGenerator::Build(Mesh & mesh, OBJData & data)
+{
+	MeshBuilder::Build(mesh, data.points, data.faceindices, data.faceoffsets);
+	mesh.update_normals();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "MeshDefinition.h"
+#include "OBJParser.h"
+
+// Procedural triangle meshes with known topology, built in parallel and
+//   handed to MeshBuilder in one go. nfaces is a target; the generated mesh
+//   has the closest face count the construction allows. A non-zero seed
+//   applies a random rigid rotation, so different seeds give different but
+//   equivalent inputs; the same seed always gives the same mesh.
+//
+//   Expected MeshTools answers:
+//     Icosphere       genus 0, no boundary, one component
+//     Torus           genus 1, no boundary, one component
+//     HoleSurface     genus holes, no boundary, one component
+//     Grid            boundary, one component (Genus returns -1)
+//     Scene           no boundary, ncomponents components (Genus returns -1)
+class MeshGenerator
+{
+public:
+	// geodesic sphere: every icosahedron face split into n x n triangles,
+	//   20 n^2 faces; n = 2^level gives the icosphere of that level
+	static void Icosphere(Mesh & mesh, const long long & nfaces, const unsigned int & seed = 0);
+	static void Torus(Mesh & mesh, const long long & nfaces, const unsigned int & seed = 0);
+	// closed surface of the given genus: the two sides of a square plate with
+	//   holes square holes, glued along the outer and the hole boundaries
+	static void HoleSurface(Mesh & mesh, const int & holes, const long long & nfaces, const unsigned int & seed = 0);
+	// open square grid in the xy plane with one boundary loop
+	static void Grid(Mesh & mesh, const long long & nfaces, const unsigned int & seed = 0);
+	// ncomponents disjoint spheres and tori sharing nfaces, placed on a lattice
+	static void Scene(Mesh & mesh, const int & ncomponents, const long long & nfaces, const unsigned int & seed = 0);
+
+	// Variants that keep the connectivity, so the expected answers above still
+	//   hold. AddNoise moves every vertex along its normal by up to amplitude
+	//   times the average edge length; AddDegenerateFaces moves a fraction of
+	//   the vertices onto a neighbour, leaving zero-area faces around them.
+	static void AddNoise(Mesh & mesh, const double & amplitude, const unsigned int & seed);
+	static void AddDegenerateFaces(Mesh & mesh, const double & fraction, const unsigned int & seed);
+private:
+	static void MakeIcosphere(long long nfaces, OBJData & data);
+	static void MakeTorus(long long nfaces, OBJData & data);
+	static void MakeHoleSurface(int holes, long long nfaces, OBJData & data);
+	static void MakeGrid(long long nfaces, OBJData & data);
+	static void Transform(OBJData & data, size_t begin, double scale, const Mesh::Point & offset, unsigned int seed);
+	static void Build(Mesh & mesh, OBJData & data);
+};
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <unordered_set>
+#include "MeshHistory.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	template <typename A>
+	void CountChunks(const A & array, std::unordered_set<const void*> & seen, size_t & bytes)
+	{
+		for (const auto & chunk : array.chunks)
+		{
+			if (seen.insert(chunk.get()).second)
+			{
+				bytes += chunk->size() * sizeof((*chunk)[0]);
+			}
+		}
+	}
+}
+
+MeshHistory::MeshHistory(void)
+	: current(0)
+{
+}
+
+void MeshHistory::Commit(const Mesh & mesh)
+{
+	if (!states.empty()) states.resize(current + 1);
+	const State none;
+	const State & previous = states.empty() ? none : states.back();
+	State state;
+	typedef Mesh::VertexHandle VH;
+	typedef Mesh::HalfedgeHandle HH;
+	typedef Mesh::EdgeHandle EH;
+	typedef Mesh::FaceHandle FH;
+	const size_t nv = mesh.n_vertices();
+	const size_t nh = mesh.n_halfedges();
+	const size_t ne = mesh.n_edges();
+	const size_t nf = mesh.n_faces();
+	Capture(previous.points, nv, [&](size_t i) { return mesh.point(VH(static_cast<int>(i))); }, state.points);
+	Capture(previous.vertexhalfedge, nv, [&](size_t i) { return mesh.halfedge_handle(VH(static_cast<int>(i))).idx(); }, state.vertexhalfedge);
+	Capture(previous.vertexstatus, nv, [&](size_t i) { return mesh.status(VH(static_cast<int>(i))).bits(); }, state.vertexstatus);
+	Capture(previous.halfedgevertex, nh, [&](size_t i) { return mesh.to_vertex_handle(HH(static_cast<int>(i))).idx(); }, state.halfedgevertex);
+	Capture(previous.halfedgenext, nh, [&](size_t i) { return mesh.next_halfedge_handle(HH(static_cast<int>(i))).idx(); }, state.halfedgenext);
+	Capture(previous.halfedgeface, nh, [&](size_t i) { return mesh.face_handle(HH(static_cast<int>(i))).idx(); }, state.halfedgeface);
+	Capture(previous.halfedgestatus, nh, [&](size_t i) { return mesh.status(HH(static_cast<int>(i))).bits(); }, state.halfedgestatus);
+	Capture(previous.edgestatus, ne, [&](size_t i) { return mesh.status(EH(static_cast<int>(i))).bits(); }, state.edgestatus);
+	Capture(previous.facehalfedge, nf, [&](size_t i) { return mesh.halfedge_handle(FH(static_cast<int>(i))).idx(); }, state.facehalfedge);
+	Capture(previous.facestatus, nf, [&](size_t i) { return mesh.status(FH(static_cast<int>(i))).bits(); }, state.facestatus);
+	states.push_back(std::move(state));
+	current = states.size() - 1;
+}
+
+bool MeshHistory::CanUndo(void) const
+{
+	return current > 0;
+}
+
+bool MeshHistory::CanRedo(void) const
+{
+	return current + 1 < states.size();
+}
+
+bool MeshHistory::Undo(Mesh & mesh)
+{
+	if (!CanUndo()) return false;
+	Restore(mesh, states[current], states[current - 1]);
+	--current;
+	MeshTools::Modified(mesh);
+	return true;
+}
+
+bool MeshHistory::Redo(Mesh & mesh)
+{
+	if (!CanRedo()) return false;
+	Restore(mesh, states[current], states[current + 1]);
+	++current;
+	MeshTools::Modified(mesh);
+	return true;
+}
+
+void MeshHistory::Clear(void)
+{
+	std::vector<State>().swap(states);
+	current = 0;
+}
+
+bool MeshHistory::Empty(void) const
+{
+	return states.empty();
+}
+
+size_t MeshHistory::Memory(void) const
+{
+	std::unordered_set<const void*> seen;
+	size_t bytes = 0;
+	for (const auto & state : states)
+	{
+		CountChunks(state.points, seen, bytes);
+		CountChunks(state.vertexhalfedge, seen, bytes);
+		CountChunks(state.vertexstatus, seen, bytes);
+		CountChunks(state.halfedgevertex, seen, bytes);
+		CountChunks(state.halfedgenext, seen, bytes);
+		CountChunks(state.halfedgeface, seen, bytes);
+		CountChunks(state.halfedgestatus, seen, bytes);
+		CountChunks(state.edgestatus, seen, bytes);
+		CountChunks(state.facehalfedge, seen, bytes);
+		CountChunks(state.facestatus, seen, bytes);
+	}
+	return bytes;
+}
+
+template <typename T, typename Get>
+void MeshHistory::Capture(const Array<T> & previous, size_t n, const Get & get, Array<T> & array)
+{
+	const int nchunks = static_cast<int>((n + chunksize - 1) / chunksize);
+	array.size = n;
+	array.chunks.resize(nchunks);
+	ThreadPool::Global().ParallelFor(nchunks, [&](int c)
+	{
+		const size_t begin = static_cast<size_t>(c) * chunksize;
+		const size_t end = std::min(n, begin + chunksize);
+		const std::vector<T>* old = c < static_cast<int>(previous.chunks.size()) ? previous.chunks[c].get() : nullptr;
+		bool same = old && old->size() == end - begin;
+		for (size_t i = begin; same && i < end; ++i)
+		{
+			same = (*old)[i - begin] == get(i);
+		}
+		if (same)
+		{
+			array.chunks[c] = previous.chunks[c];
+			return;
+		}
+		auto chunk = std::make_shared<std::vector<T>>(end - begin);
+		for (size_t i = begin; i < end; ++i)
+		{
+			(*chunk)[i - begin] = get(i);
+		}
+		array.chunks[c] = chunk;
+	});
+}
+
+template <typename T, typename Set>
+void MeshHistory::Apply(const Array<T> & from, const Array<T> & to, const Set & set)
+{
+	for (size_t c = 0; c < to.chunks.size(); ++c)
+	{
+		if (c < from.chunks.size() && from.chunks[c] == to.chunks[c]) continue;
+		const std::vector<T> & chunk = *to.chunks[c];
+		for (size_t i = 0; i < chunk.size(); ++i)
+		{
+			set(c * chunksize + i, chunk[i]);
+		}
+	}
+}
+
+void MeshHistory::Restore(Mesh & mesh, const State & from, const State & to)
+{
+	typedef Mesh::VertexHandle VH;
+	typedef Mesh::HalfedgeHandle HH;
+	typedef Mesh::EdgeHandle EH;
+	typedef Mesh::FaceHandle FH;
+	mesh.resize(to.points.size, to.edgestatus.size, to.facestatus.size);
+	Apply(from.points, to.points, [&](size_t i, const Mesh::Point & p) { mesh.set_point(VH(static_cast<int>(i)), p); });
+	Apply(from.vertexhalfedge, to.vertexhalfedge, [&](size_t i, int h) { mesh.set_halfedge_handle(VH(static_cast<int>(i)), HH(h)); });
+	Apply(from.vertexstatus, to.vertexstatus, [&](size_t i, unsigned int s) { mesh.status(VH(static_cast<int>(i))).set_bits(s); });
+	Apply(from.halfedgevertex, to.halfedgevertex, [&](size_t i, int v) { mesh.set_vertex_handle(HH(static_cast<int>(i)), VH(v)); });
+	Apply(from.halfedgeface, to.halfedgeface, [&](size_t i, int f) { mesh.set_face_handle(HH(static_cast<int>(i)), FH(f)); });
+	Apply(from.halfedgestatus, to.halfedgestatus, [&](size_t i, unsigned int s) { mesh.status(HH(static_cast<int>(i))).set_bits(s); });
+	Apply(from.edgestatus, to.edgestatus, [&](size_t i, unsigned int s) { mesh.status(EH(static_cast<int>(i))).set_bits(s); });
+	Apply(from.facehalfedge, to.facehalfedge, [&](size_t i, int h) { mesh.set_halfedge_handle(FH(static_cast<int>(i)), HH(h)); });
+	Apply(from.facestatus, to.facestatus, [&](size_t i, unsigned int s) { mesh.status(FH(static_cast<int>(i))).set_bits(s); });
+
+	Apply(from.halfedgenext, to.halfedgenext, [&](size_t i, int n)
+	{
+		if (n >= 0) mesh.set_next_halfedge_handle(HH(static_cast<int>(i)), HH(n));
+	});
+}
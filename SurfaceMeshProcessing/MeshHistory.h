@@ -0,0 +1,69 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "MeshDefinition.h"
+
+// Undo and redo for a mesh that is edited in place. Every recorded state
+//   keeps the points, the connectivity and the status flags in chunks of
+//   chunksize elements, and a chunk that an edit did not touch is shared with
+//   the state before, so a state costs memory only for the chunks that
+//   changed. Undo and redo write back only the chunks in which the two
+//   states differ.
+//
+//   Normals and other properties are not recorded; recompute the normals
+//   after Undo and Redo (MeshViewerWidget::UpdateMesh does).
+class MeshHistory
+{
+public:
+	MeshHistory(void);
+	// Records the state of mesh as the newest one, and forgets the states
+	//   that could be redone. Call it before the first edit and after each
+	//   edit; it compares every chunk with the state before.
+	void Commit(const Mesh & mesh);
+	bool CanUndo(void) const;
+	bool CanRedo(void) const;
+	// mesh must be in the state last committed or restored
+	bool Undo(Mesh & mesh);
+	bool Redo(Mesh & mesh);
+	void Clear(void);
+	bool Empty(void) const;
+	// bytes held by the chunks of all states, shared chunks counted once
+	size_t Memory(void) const;
+
+	static const int chunksize = 1 << 14;
+private:
+	template <typename T>
+	struct Array
+	{
+		size_t size = 0;
+		std::vector<std::shared_ptr<const std::vector<T>>> chunks;
+	};
+	struct State
+	{
+		Array<Mesh::Point> points;
+		Array<int> vertexhalfedge;
+		Array<unsigned int> vertexstatus;
+		Array<int> halfedgevertex;
+		// MeshTraits has no PrevHalfedge attribute, so there are no prev
+		//   handles to keep; prev_halfedge_handle walks the next ones
+		Array<int> halfedgenext;
+		Array<int> halfedgeface;
+		Array<unsigned int> halfedgestatus;
+		Array<unsigned int> edgestatus;
+		Array<int> facehalfedge;
+		Array<unsigned int> facestatus;
+	};
+	// array gets element i = get(i) of [0, n), sharing the chunks equal to
+	//   those of previous
+	template <typename T, typename Get>
+	static void Capture(const Array<T> & previous, size_t n, const Get & get, Array<T> & array);
+	// calls set(i, value) for the elements of the chunks of to that from
+	//   does not share
+	template <typename T, typename Set>
+	static void Apply(const Array<T> & from, const Array<T> & to, const Set & set);
+	static void Restore(Mesh & mesh, const State & from, const State & to);
+private:
+	std::vector<State> states;
+	// the state the mesh is in
+	size_t current;
+};
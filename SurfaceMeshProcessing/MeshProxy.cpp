@@ -0,0 +1,123 @@
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "MeshProxy.h"
+#include "MeshReduction.h"
+
+bool MeshProxy::Cluster(const Mesh & mesh, const int & targetfaces, std::vector<float> & points, std::vector<unsigned int> & triangles, const std::atomic<bool>* cancelled)
+{
+	points.clear();
+	triangles.clear();
+	// polled every 64K elements
+	auto stopped = [cancelled](int i)
+	{
+		return (i & 0xffff) == 0 && cancelled && cancelled->load();
+	};
+	Mesh::Point bmax(0.0), bmin(0.0);
+	MeshReduction::BoundingBox(mesh, bmax, bmin);
+	const Mesh::Point extent = bmax - bmin;
+	const double size = std::max({ extent[0], extent[1], extent[2] });
+	if (!(size > 0.0)) return true;
+	// cubic cells, r of them along the longest side
+	auto cell = [&](const Mesh::Point & p, const int & r, int* c)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			c[k] = std::min(r - 1, static_cast<int>((p[k] - bmin[k]) / size * r));
+		}
+	};
+	const int nv = static_cast<int>(mesh.n_vertices());
+	const int nf = static_cast<int>(mesh.n_faces());
+
+	const int r0 = countresolution;
+	std::vector<bool> occupied(r0 * r0 * r0, false);
+	int noccupied = 0;
+	for (int v = 0; v < nv; ++v)
+	{
+		if (stopped(v)) return false;
+		Mesh::VertexHandle vh(v);
+		if (mesh.status(vh).deleted()) continue;
+		int c[3];
+		cell(mesh.point(vh), r0, c);
+		const int i = (c[0] * r0 + c[1]) * r0 + c[2];
+		if (!occupied[i])
+		{
+			occupied[i] = true;
+			++noccupied;
+		}
+	}
+	// a closed triangle mesh has about twice as many faces as vertices
+	const double targetvertices = std::max(4.0, 0.5 * targetfaces);
+	const int r = static_cast<int>(std::min(static_cast<double>(1 << 20),
+		std::max(2.0, r0 * std::sqrt(targetvertices / std::max(noccupied, 1)))));
+
+	// cell coordinates below 2^20 fit in 20 bits each
+	std::unordered_map<uint64_t, int> clusters;
+	clusters.reserve(static_cast<size_t>(2.0 * targetvertices));
+	std::vector<int> vertexcluster(nv, -1);
+	std::vector<double> sums;
+	std::vector<int> counts;
+	for (int v = 0; v < nv; ++v)
+	{
+		if (stopped(v)) return false;
+		Mesh::VertexHandle vh(v);
+		if (mesh.status(vh).deleted()) continue;
+		const Mesh::Point & p = mesh.point(vh);
+		int c[3];
+		cell(p, r, c);
+		const uint64_t key = (static_cast<uint64_t>(c[0]) << 40) | (static_cast<uint64_t>(c[1]) << 20) | static_cast<uint64_t>(c[2]);
+		auto it = clusters.emplace(key, static_cast<int>(counts.size()));
+		if (it.second)
+		{
+			sums.resize(sums.size() + 3, 0.0);
+			counts.push_back(0);
+		}
+		const int id = it.first->second;
+		for (int k = 0; k < 3; ++k)
+		{
+			sums[3 * id + k] += p[k];
+		}
+		++counts[id];
+		vertexcluster[v] = id;
+	}
+	std::unordered_map<uint64_t, int>().swap(clusters);
+	points.resize(sums.size());
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		points[i] = static_cast<float>(sums[i] / counts[i / 3]);
+	}
+
+	// drops the faces that collapsed, and repeats of a triangle when the
+	//   cluster ids fit in 21 bits
+	const bool unique = counts.size() < (1u << 21);
+	std::unordered_set<uint64_t> seen;
+	for (int f = 0; f < nf; ++f)
+	{
+		if (stopped(f))
+		{
+			points.clear();
+			triangles.clear();
+			return false;
+		}
+		Mesh::FaceHandle fh(f);
+		if (mesh.status(fh).deleted()) continue;
+		unsigned int t[3];
+		int k = 0;
+		for (const auto & fvh : mesh.fv_range(fh))
+		{
+			t[k++] = vertexcluster[fvh.idx()];
+		}
+		if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) continue;
+		if (unique)
+		{
+			unsigned int s[3] = { t[0], t[1], t[2] };
+			std::sort(s, s + 3);
+			const uint64_t key = (static_cast<uint64_t>(s[0]) << 42) | (static_cast<uint64_t>(s[1]) << 21) | static_cast<uint64_t>(s[2]);
+			if (!seen.insert(key).second) continue;
+		}
+		triangles.insert(triangles.end(), t, t + 3);
+	}
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "MeshDefinition.h"
+
+// A coarse stand-in for a large mesh, drawn instead of it while the view
+//   moves. Vertex clustering (Rossignac and Borrel, 1993) merges the vertices
+//   in each cell of a uniform grid over the bounding box into their average,
+//   and keeps the faces whose corners fall into three different cells. It
+//   takes linear time and ignores the topology, so the proxy may have holes
+//   and non-manifold edges; it is only meant to be looked at.
+class MeshProxy
+{
+public:
+	// Fills points with x, y, z per proxy vertex and triangles with three
+	//   vertex indices per proxy triangle, about targetfaces of them; the grid
+	//   is sized assuming the occupied cells grow with the square of its
+	//   resolution, as they do for a surface. Returns false and leaves both
+	//   empty if cancelled is set while it runs.
+	static bool Cluster(const Mesh & mesh, const int & targetfaces, std::vector<float> & points, std::vector<unsigned int> & triangles, const std::atomic<bool>* cancelled = nullptr);
+
+	// grid cells per axis of the first pass of Cluster, which counts the
+	//   occupied cells to choose the resolution of the second
+	static const int countresolution = 64;
+};
@@ -0,0 +1,100 @@
+#include <vector>
+#include "MeshReduction.h"
+
+namespace
+{
+	// the sum of term(i) over [0, n)
+	template <typename Term>
+	double BlockedSum(int n, bool parallel, const Term & term)
+	{
+		const int blocksize = ThreadPool::blocksize;
+		std::vector<double> sums((n + blocksize - 1) / blocksize, 0.0);
+		ThreadPool::Global().ParallelBlocks(n, parallel, [&](int b, int begin, int end)
+		{
+			double values[blocksize];
+			for (int i = begin; i < end; ++i)
+			{
+				values[i - begin] = term(i);
+			}
+			sums[b] = MeshReduction::PairwiseSum(values, end - begin);
+		});
+		return MeshReduction::PairwiseSum(sums.data(), static_cast<int>(sums.size()));
+	}
+}
+
+double MeshReduction::Area(const Mesh & mesh, const bool & parallel)
+{
+	const Mesh::Point* points = mesh.points();
+	return BlockedSum(static_cast<int>(mesh.n_faces()), parallel, [&](int i) -> double
+	{
+		Mesh::FaceHandle fh(i);
+		if (mesh.status(fh).deleted()) return 0.0;
+		auto heh = mesh.halfedge_handle(fh);
+		const auto & p0 = points[mesh.from_vertex_handle(heh).idx()];
+		const auto & p1 = points[mesh.to_vertex_handle(heh).idx()];
+		const auto & p2 = points[mesh.to_vertex_handle(mesh.next_halfedge_handle(heh)).idx()];
+		return 0.5 * ((p1 - p0) % (p2 - p0)).norm();
+	});
+}
+
+double MeshReduction::EdgeLengthSum(const Mesh & mesh, const bool & parallel)
+{
+	const Mesh::Point* points = mesh.points();
+	return BlockedSum(static_cast<int>(mesh.n_edges()), parallel, [&](int i) -> double
+	{
+		Mesh::EdgeHandle eh(i);
+		if (mesh.status(eh).deleted()) return 0.0;
+		auto heh = mesh.halfedge_handle(eh, 0);
+		return (points[mesh.to_vertex_handle(heh).idx()] - points[mesh.from_vertex_handle(heh).idx()]).norm();
+	});
+}
+
+void MeshReduction::BoundingBox(const Mesh & mesh, Mesh::Point & bmax, Mesh::Point & bmin, const bool & parallel)
+{
+	// min and max are exact, so only the blocks without vertices need care
+	const Mesh::Point* points = mesh.points();
+	int n = static_cast<int>(mesh.n_vertices());
+	const int blocksize = ThreadPool::blocksize;
+	int nblocks = (n + blocksize - 1) / blocksize;
+	std::vector<Mesh::Point> blockmax(nblocks), blockmin(nblocks);
+	std::vector<char> found(nblocks, 0);
+	ThreadPool::Global().ParallelBlocks(n, parallel, [&](int b, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (mesh.status(Mesh::VertexHandle(i)).deleted()) continue;
+			if (!found[b])
+			{
+				blockmax[b] = blockmin[b] = points[i];
+				found[b] = 1;
+			}
+			blockmax[b].maximize(points[i]);
+			blockmin[b].minimize(points[i]);
+		}
+	});
+	bool first = true;
+	for (int b = 0; b < nblocks; ++b)
+	{
+		if (!found[b]) continue;
+		if (first)
+		{
+			bmax = blockmax[b];
+			bmin = blockmin[b];
+			first = false;
+		}
+		bmax.maximize(blockmax[b]);
+		bmin.minimize(blockmin[b]);
+	}
+}
+
+double MeshReduction::PairwiseSum(const double* values, int n)
+{
+	if (n <= 16)
+	{
+		double s = 0.0;
+		for (int i = 0; i < n; ++i) s += values[i];
+		return s;
+	}
+	int half = n / 2;
+	return PairwiseSum(values, half) + PairwiseSum(values + half, n - half);
+}
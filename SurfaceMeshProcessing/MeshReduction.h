@@ -0,0 +1,23 @@
+#pragma once
+#include <algorithm>
+#include "MeshDefinition.h"
+#include "ThreadPool.h"
+
+// Reductions over the mesh arrays behind MeshTools::Area, AverageEdgeLength
+//   and BoundingBox. A sum is split into blocks of fixed size that are summed
+//   pairwise, and the block sums are summed pairwise again, so the rounding
+//   depends only on the mesh: the result is the same bit for bit with any
+//   number of threads, and with parallel off, when the blocks run in order on
+//   the calling thread. Deleted elements are skipped.
+class MeshReduction
+{
+public:
+	static double Area(const Mesh & mesh, const bool & parallel = true);
+	static double EdgeLengthSum(const Mesh & mesh, const bool & parallel = true);
+	// leaves bmax and bmin unchanged if the mesh has no vertices
+	static void BoundingBox(const Mesh & mesh, Mesh::Point & bmax, Mesh::Point & bmin, const bool & parallel = true);
+
+	// pairwise summation: the error grows with log n instead of n, and the
+	//   short leaf loops vectorize
+	static double PairwiseSum(const double* values, int n);
+};
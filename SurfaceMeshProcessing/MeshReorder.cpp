@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include "MeshReorder.h"
+#include "MeshReduction.h"
+
+namespace
+{
+	// the 21 low bits of x moved to every third bit
+	inline unsigned long long Spread(unsigned long long x)
+	{
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffULL;
+		x = (x | x << 16) & 0x1f0000ff0000ffULL;
+		x = (x | x << 8) & 0x100f00f00f00f00fULL;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+		x = (x | x << 2) & 0x1249249249249249ULL;
+		return x;
+	}
+}
+
+void MeshReorder::Reorder(Mesh & mesh, const Order & order, MeshCompactor::Remap* remap)
+{
+	std::vector<int> vertexmap, facemap;
+	VertexOrder(mesh, order, vertexmap);
+	FaceOrder(mesh, vertexmap, facemap);
+	MeshCompactor::Renumber(mesh, std::move(vertexmap), std::move(facemap), remap);
+}
+
+void MeshReorder::VertexOrder(const Mesh & mesh, const Order & order, std::vector<int> & vertexmap)
+{
+	const int nv = static_cast<int>(mesh.n_vertices());
+	std::vector<int> vertices;
+	if (order == ORDER_RCM)
+	{
+		CuthillMcKee(mesh, vertices);
+	}
+	else
+	{
+		CurveOrder(mesh, order == ORDER_HILBERT, vertices);
+	}
+	vertexmap.assign(nv, -1);
+	int n = 0;
+	for (int v : vertices)
+	{
+		if (mesh.status(Mesh::VertexHandle(v)).deleted()) break;
+		vertexmap[v] = n++;
+	}
+	for (auto & i : vertexmap)
+	{
+		if (i < 0) i = n++;
+	}
+}
+
+void MeshReorder::FaceOrder(const Mesh & mesh, const std::vector<int> & vertexmap, std::vector<int> & facemap)
+{
+	// a counting sort on the smallest new vertex index, stable in the old
+	//   face order; kept faces have only kept vertices
+	const int nv = static_cast<int>(mesh.n_vertices());
+	const int nf = static_cast<int>(mesh.n_faces());
+	std::vector<int> first(nf, -1);
+	ThreadPool::Global().ParallelBlocks(nf, true, [&](int, int begin, int end)
+	{
+		for (int f = begin; f < end; ++f)
+		{
+			Mesh::FaceHandle fh(f);
+			if (mesh.status(fh).deleted()) continue;
+			int v0 = nv;
+			for (const auto & vh : mesh.fv_range(fh))
+			{
+				v0 = std::min(v0, vertexmap[vh.idx()]);
+			}
+			first[f] = v0;
+		}
+	});
+	std::vector<int> start(nv + 1, 0);
+	for (int f = 0; f < nf; ++f)
+	{
+		if (first[f] >= 0) ++start[first[f] + 1];
+	}
+	for (int v = 0; v < nv; ++v) start[v + 1] += start[v];
+	int removed = start[nv];
+	facemap.resize(nf);
+	for (int f = 0; f < nf; ++f)
+	{
+		facemap[f] = first[f] >= 0 ? start[first[f]]++ : removed++;
+	}
+}
+
+double MeshReorder::AverageEdgeSpan(const Mesh & mesh)
+{
+	const int ne = static_cast<int>(mesh.n_edges());
+	const int blocksize = ThreadPool::blocksize;
+	const int nblocks = (ne + blocksize - 1) / blocksize;
+	std::vector<double> sums(nblocks, 0.0);
+	std::vector<int> counts(nblocks, 0);
+	ThreadPool::Global().ParallelBlocks(ne, true, [&](int b, int begin, int end)
+	{
+		double values[blocksize];
+		int n = 0;
+		for (int e = begin; e < end; ++e)
+		{
+			Mesh::EdgeHandle eh(e);
+			if (mesh.status(eh).deleted()) continue;
+			auto heh = mesh.halfedge_handle(eh, 0);
+			values[n++] = std::abs(mesh.to_vertex_handle(heh).idx() - mesh.from_vertex_handle(heh).idx());
+		}
+		sums[b] = MeshReduction::PairwiseSum(values, n);
+		counts[b] = n;
+	});
+	long long count = 0;
+	for (int n : counts) count += n;
+	return count ? MeshReduction::PairwiseSum(sums.data(), nblocks) / count : 0.0;
+}
+
+void MeshReorder::CurveOrder(const Mesh & mesh, bool hilbert, std::vector<int> & vertices)
+{
+	// one scale for all axes keeps the grid cells cubic; deleted vertices get
+	//   a key above every curve key and go last
+	const int nv = static_cast<int>(mesh.n_vertices());
+	const unsigned int cells = (1u << 21) - 1;
+	Mesh::Point bmax(0.0), bmin(0.0);
+	MeshReduction::BoundingBox(mesh, bmax, bmin);
+	double extent = 0.0;
+	for (int k = 0; k < 3; ++k) extent = std::max(extent, static_cast<double>(bmax[k] - bmin[k]));
+	const double scale = extent > 0.0 ? cells / extent : 0.0;
+
+	const Mesh::Point* points = mesh.points();
+	std::vector<std::pair<unsigned long long, int>> keys(nv);
+	ThreadPool::Global().ParallelBlocks(nv, true, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			if (mesh.status(Mesh::VertexHandle(v)).deleted())
+			{
+				keys[v] = std::make_pair(~0ULL, v);
+				continue;
+			}
+			unsigned int q[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				q[k] = std::min(cells, static_cast<unsigned int>((points[v][k] - bmin[k]) * scale));
+			}
+			keys[v] = std::make_pair(hilbert ? HilbertKey(q[0], q[1], q[2]) : MortonKey(q[0], q[1], q[2]), v);
+		}
+	});
+	std::sort(keys.begin(), keys.end());
+	vertices.resize(nv);
+	ThreadPool::Global().ParallelBlocks(nv, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i) vertices[i] = keys[i].second;
+	});
+}
+
+void MeshReorder::CuthillMcKee(const Mesh & mesh, std::vector<int> & vertices)
+{
+	const int nv = static_cast<int>(mesh.n_vertices());
+	std::vector<int> degree(nv, 0);
+	ThreadPool::Global().ParallelBlocks(nv, true, [&](int, int begin, int end)
+	{
+		for (int v = begin; v < end; ++v)
+		{
+			Mesh::VertexHandle vh(v);
+			if (!mesh.status(vh).deleted()) degree[v] = static_cast<int>(mesh.valence(vh));
+		}
+	});
+
+	// the depth of the breadth first levels from root, and the last level
+	std::vector<int> stamp(nv, -1), frontier, next;
+	int search = 0;
+	auto levels = [&](int root, std::vector<int> & last)
+	{
+		++search;
+		stamp[root] = search;
+		frontier.assign(1, root);
+		int depth = 0;
+		while (true)
+		{
+			next.clear();
+			for (int v : frontier)
+			{
+				for (const auto & h : mesh.voh_range(Mesh::VertexHandle(v)))
+				{
+					int w = mesh.to_vertex_handle(h).idx();
+					if (stamp[w] == search) continue;
+					stamp[w] = search;
+					next.push_back(w);
+				}
+			}
+			if (next.empty()) break;
+			frontier.swap(next);
+			++depth;
+		}
+		last.swap(frontier);
+		return depth;
+	};
+	auto smallest = [&](const std::vector<int> & level)
+	{
+		return *std::min_element(level.begin(), level.end(), [&](int a, int b)
+		{
+			return std::make_pair(degree[a], a) < std::make_pair(degree[b], b);
+		});
+	};
+
+	std::vector<char> placed(nv, 0);
+	std::vector<int> last, candidatelast, neighbours;
+	vertices.clear();
+	vertices.reserve(nv);
+	for (int s = 0; s < nv; ++s)
+	{
+		if (placed[s] || mesh.status(Mesh::VertexHandle(s)).deleted()) continue;
+
+		// pseudo-peripheral root (George and Liu): move to the smallest degree
+		//   vertex of the last level while that makes the levels deeper
+		int root = s;
+		int depth = levels(root, last);
+		for (int iteration = 0; iteration < 4; ++iteration)
+		{
+			int candidate = smallest(last);
+			int d = levels(candidate, candidatelast);
+			if (d <= depth) break;
+			root = candidate;
+			depth = d;
+			last.swap(candidatelast);
+		}
+
+		// breadth first from the root, neighbours by increasing degree
+		size_t head = vertices.size();
+		placed[root] = 1;
+		vertices.push_back(root);
+		while (head < vertices.size())
+		{
+			int v = vertices[head++];
+			neighbours.clear();
+			for (const auto & h : mesh.voh_range(Mesh::VertexHandle(v)))
+			{
+				int w = mesh.to_vertex_handle(h).idx();
+				if (placed[w]) continue;
+				placed[w] = 1;
+				neighbours.push_back(w);
+			}
+			std::sort(neighbours.begin(), neighbours.end(), [&](int a, int b)
+			{
+				return std::make_pair(degree[a], a) < std::make_pair(degree[b], b);
+			});
+			vertices.insert(vertices.end(), neighbours.begin(), neighbours.end());
+		}
+	}
+	std::reverse(vertices.begin(), vertices.end());
+}
+
+unsigned long long MeshReorder::MortonKey(unsigned int x, unsigned int y, unsigned int z)
+{
+	return Spread(x) << 2 | Spread(y) << 1 | Spread(z);
+}
+
+unsigned long long MeshReorder::HilbertKey(unsigned int x, unsigned int y, unsigned int z)
+{
+	// Skilling, "Programming the Hilbert curve" (2004): turn the coordinates
+	//   into the transposed Hilbert index, whose bits interleave like Morton's
+	unsigned int X[3] = { x, y, z };
+	const unsigned int M = 1u << 20;
+	for (unsigned int Q = M; Q > 1; Q >>= 1)
+	{
+		unsigned int P = Q - 1;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (X[i] & Q)
+			{
+				X[0] ^= P;
+			}
+			else
+			{
+				unsigned int t = (X[0] ^ X[i]) & P;
+				X[0] ^= t;
+				X[i] ^= t;
+			}
+		}
+	}
+	for (int i = 1; i < 3; ++i) X[i] ^= X[i - 1];
+	unsigned int t = 0;
+	for (unsigned int Q = M; Q > 1; Q >>= 1)
+	{
+		if (X[2] & Q) t ^= Q - 1;
+	}
+	for (int i = 0; i < 3; ++i) X[i] ^= t;
+	return MortonKey(X[0], X[1], X[2]);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "MeshDefinition.h"
+#include "MeshCompactor.h"
+
+// Renumbers the elements of a mesh so that neighbours are close in memory,
+//   which the order of an exported file rarely gives. Vertices are sorted
+//   along a space-filling curve through their positions, or by reverse
+//   Cuthill-McKee on the vertex graph, which keeps the index distance of the
+//   edges small. Faces follow their smallest new vertex index and edges follow
+//   the faces, see MeshCompactor, which moves the arrays and every property.
+class MeshReorder
+{
+public:
+	// ORDER_MORTON and ORDER_HILBERT sort by the curve key of the position on
+	//   a 2^21 grid over the bounding box; Hilbert is slower to compute and
+	//   never jumps across the box. ORDER_RCM needs only the connectivity.
+	enum Order { ORDER_MORTON, ORDER_HILBERT, ORDER_RCM };
+	// Deleted elements are removed as in MeshCompactor::Compact. remap maps
+	//   every original index to the new one, so a per-vertex result r computed
+	//   on the reordered mesh is r[remap->vertices[v]] for original vertex v.
+	static void Reorder(Mesh & mesh, const Order & order, MeshCompactor::Remap* remap = nullptr);
+
+	// old index -> new index with the kept elements first, deleted ones last
+	static void VertexOrder(const Mesh & mesh, const Order & order, std::vector<int> & vertexmap);
+	static void FaceOrder(const Mesh & mesh, const std::vector<int> & vertexmap, std::vector<int> & facemap);
+	// mean index distance between the two vertices of an edge, how far apart
+	//   in memory a circulator finds the neighbours of a vertex
+	static double AverageEdgeSpan(const Mesh & mesh);
+private:
+	static void CurveOrder(const Mesh & mesh, bool hilbert, std::vector<int> & vertices);
+	static void CuthillMcKee(const Mesh & mesh, std::vector<int> & vertices);
+	static unsigned long long MortonKey(unsigned int x, unsigned int y, unsigned int z);
+	static unsigned long long HilbertKey(unsigned int x, unsigned int y, unsigned int z);
+};
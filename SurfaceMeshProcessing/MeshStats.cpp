@@ -0,0 +1,179 @@
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cfloat>
+#include "MeshStats.h"
+#include "MeshReduction.h"
+#include "MeshComponents.h"
+
+MeshStats::Values::Values(void)
+	: nvertices(0), nedges(0), nfaces(0), bmin(0.0), bmax(0.0), area(0.0),
+	minedgelength(0.0), maxedgelength(0.0), avgedgelength(0.0),
+	nboundaryedges(0), nboundaryloops(0), ncomponents(0), euler(0), genus(0)
+{
+}
+
+MeshStats::MeshStats(void)
+	: computed(0), computedmesh(nullptr)
+{
+}
+
+void MeshStats::Compute(const Mesh & mesh, Values & values, const bool & parallel)
+{
+	struct Block
+	{
+		Mesh::Point bmin, bmax;
+		bool found = false;
+		double area = 0.0, edgelength = 0.0;
+		double minlen = DBL_MAX, maxlen = 0.0;
+		long long nvertices = 0, nedges = 0, nfaces = 0, nboundaryedges = 0;
+	};
+	const int blocksize = ThreadPool::blocksize;
+	const Mesh::Point* points = mesh.points();
+	int nv = static_cast<int>(mesh.n_vertices());
+	int ne = static_cast<int>(mesh.n_edges());
+	int nf = static_cast<int>(mesh.n_faces());
+	int n = std::max(nv, std::max(ne, nf));
+	std::vector<Block> blocks((n + blocksize - 1) / blocksize);
+	// union-find over the faces, joined across edges, and over the boundary
+	//   edges, joined along their loops
+	std::unique_ptr<std::atomic<int>[]> faceparent(new std::atomic<int>[nf]);
+	std::unique_ptr<std::atomic<int>[]> loopparent(new std::atomic<int>[ne]);
+	ThreadPool::Global().ParallelBlocks(std::max(ne, nf), parallel, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < std::min(end, nf); ++i) faceparent[i].store(i, std::memory_order_relaxed);
+		for (int i = begin; i < std::min(end, ne); ++i) loopparent[i].store(i, std::memory_order_relaxed);
+	});
+	// block b covers the same vertices, edges and faces as in MeshReduction
+	ThreadPool::Global().ParallelBlocks(n, parallel, [&](int b, int begin, int end)
+	{
+		Block & block = blocks[b];
+		double lengths[blocksize];
+		for (int i = begin; i < std::min(end, nv); ++i)
+		{
+			Mesh::VertexHandle vh(i);
+			if (mesh.status(vh).deleted()) continue;
+			if (!block.found)
+			{
+				block.bmax = block.bmin = points[i];
+				block.found = true;
+			}
+			block.bmax.maximize(points[i]);
+			block.bmin.minimize(points[i]);
+			if (mesh.halfedge_handle(vh).is_valid()) ++block.nvertices;
+		}
+		for (int i = begin; i < std::min(end, ne); ++i)
+		{
+			Mesh::EdgeHandle eh(i);
+			lengths[i - begin] = 0.0;
+			if (mesh.status(eh).deleted()) continue;
+			auto heh = mesh.halfedge_handle(eh, 0);
+			double len = (points[mesh.to_vertex_handle(heh).idx()] - points[mesh.from_vertex_handle(heh).idx()]).norm();
+			lengths[i - begin] = len;
+			block.minlen = std::min(block.minlen, len);
+			block.maxlen = std::max(block.maxlen, len);
+			++block.nedges;
+			if (mesh.is_boundary(eh))
+			{
+				++block.nboundaryedges;
+				auto boundary = mesh.is_boundary(heh) ? heh : mesh.opposite_halfedge_handle(heh);
+				MeshComponents::Unite(loopparent.get(), i, mesh.edge_handle(mesh.next_halfedge_handle(boundary)).idx());
+			}
+			else
+			{
+				MeshComponents::Unite(faceparent.get(), mesh.face_handle(heh).idx(), mesh.face_handle(mesh.opposite_halfedge_handle(heh)).idx());
+			}
+		}
+		if (begin < ne) block.edgelength = MeshReduction::PairwiseSum(lengths, std::min(end, ne) - begin);
+		double areas[blocksize];
+		for (int i = begin; i < std::min(end, nf); ++i)
+		{
+			Mesh::FaceHandle fh(i);
+			areas[i - begin] = 0.0;
+			if (mesh.status(fh).deleted()) continue;
+			auto heh = mesh.halfedge_handle(fh);
+			const auto & p0 = points[mesh.from_vertex_handle(heh).idx()];
+			const auto & p1 = points[mesh.to_vertex_handle(heh).idx()];
+			const auto & p2 = points[mesh.to_vertex_handle(mesh.next_halfedge_handle(heh)).idx()];
+			areas[i - begin] = 0.5 * ((p1 - p0) % (p2 - p0)).norm();
+			++block.nfaces;
+		}
+		if (begin < nf) block.area = MeshReduction::PairwiseSum(areas, std::min(end, nf) - begin);
+	});
+	// with all unions done, a component or a loop is a root
+	long long nboundaryloops = MeshComponents::Count(loopparent.get(), ne, [&](int e)
+	{
+		Mesh::EdgeHandle eh(e);
+		return mesh.status(eh).deleted() || !mesh.is_boundary(eh);
+	}, parallel);
+	long long ncomponents = MeshComponents::Count(faceparent.get(), nf, [&](int f) { return mesh.status(Mesh::FaceHandle(f)).deleted(); }, parallel);
+
+	// the block sums in the same pairwise order as MeshReduction
+	std::vector<double> sums((ne + blocksize - 1) / blocksize);
+	for (size_t b = 0; b < sums.size(); ++b) sums[b] = blocks[b].edgelength;
+	double edgelength = MeshReduction::PairwiseSum(sums.data(), static_cast<int>(sums.size()));
+	sums.resize((nf + blocksize - 1) / blocksize);
+	for (size_t b = 0; b < sums.size(); ++b) sums[b] = blocks[b].area;
+	values = Values();
+	values.area = MeshReduction::PairwiseSum(sums.data(), static_cast<int>(sums.size()));
+	bool found = false;
+	double minlen = DBL_MAX;
+	for (const auto & block : blocks)
+	{
+		if (block.found)
+		{
+			if (!found)
+			{
+				values.bmax = block.bmax;
+				values.bmin = block.bmin;
+			}
+			values.bmax.maximize(block.bmax);
+			values.bmin.minimize(block.bmin);
+			found = true;
+		}
+		minlen = std::min(minlen, block.minlen);
+		values.maxedgelength = std::max(values.maxedgelength, block.maxlen);
+		values.nvertices += block.nvertices;
+		values.nedges += block.nedges;
+		values.nfaces += block.nfaces;
+		values.nboundaryedges += block.nboundaryedges;
+	}
+	values.nboundaryloops = nboundaryloops;
+	values.ncomponents = ncomponents;
+	if (values.nedges > 0)
+	{
+		values.minedgelength = minlen;
+		values.avgedgelength = edgelength / ne;
+	}
+
+	values.euler = values.nvertices - values.nedges + values.nfaces;
+	values.genus = (2 * values.ncomponents - values.nboundaryloops - values.euler) / 2;
+}
+
+const MeshStats::Values & MeshStats::Get(const Mesh & mesh)
+{
+	unsigned long long modification = MeshTools::Modification(mesh);
+	if (modification == 0 || computed != modification || computedmesh != &mesh)
+	{
+		Compute(mesh, values);
+		computed = modification;
+		computedmesh = &mesh;
+	}
+	return values;
+}
+
+void MeshStats::Print(const Values & values, std::ostream & os)
+{
+	os << "  [V, E, F] = [" << values.nvertices << ", " << values.nedges << ", " << values.nfaces << "]\n";
+	os << "  BoundingBox:\n";
+	os << "  X: [" << values.bmin[0] << ", " << values.bmax[0] << "]\n";
+	os << "  Y: [" << values.bmin[1] << ", " << values.bmax[1] << "]\n";
+	os << "  Z: [" << values.bmin[2] << ", " << values.bmax[2] << "]\n";
+	os << "  Diag length of BBox: " << (values.bmax - values.bmin).norm() << "\n";
+	os << "  Edge Length: [" << values.minedgelength << ", " << values.maxedgelength << "]; AVG: " << values.avgedgelength << "\n";
+	os << "  Area: " << values.area << "\n";
+	os << "  Components: " << values.ncomponents << "; Boundary loops: " << values.nboundaryloops
+		<< "; Euler characteristic: " << values.euler << "; Genus: " << values.genus << std::endl;
+}
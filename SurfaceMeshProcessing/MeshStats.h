@@ -0,0 +1,48 @@
+#pragma once
+#include <ostream>
+#include "MeshDefinition.h"
+
+// Size, extent and topology of a mesh, computed in one blocked pass over the
+//   vertex, edge and face arrays, which also joins the faces across edges and
+//   the boundary edges along their loops in the union-find of MeshComponents,
+//   and a second one that counts the roots. Get caches the values until the
+//   mesh's stamp of MeshTools::Modified changes, or the mesh is another one;
+//   a mesh that was never stamped is computed on every call.
+class MeshStats
+{
+public:
+	// Counts skip deleted elements, and nvertices skips isolated vertices.
+	//   genus is the total over all components, (2 ncomponents - nboundaryloops
+	//   - euler) / 2, which holds for orientable surfaces with or without
+	//   boundary. A boundary loop is a cycle of boundary halfedges, which passes
+	//   on through a vertex where components touch, so there genus differs
+	//   from the per-component one of MeshComponents::Analyze. area and the
+	//   edge length sum equal MeshTools::Area and AverageEdgeLength bit for bit.
+	struct Values
+	{
+		Values(void);
+		long long nvertices;
+		long long nedges;
+		long long nfaces;
+		Mesh::Point bmin;
+		Mesh::Point bmax;
+		double area;
+		double minedgelength;
+		double maxedgelength;
+		double avgedgelength;
+		long long nboundaryedges;
+		long long nboundaryloops;
+		long long ncomponents;
+		long long euler;
+		long long genus;
+	};
+	MeshStats(void);
+	static void Compute(const Mesh & mesh, Values & values, const bool & parallel = true);
+	const Values & Get(const Mesh & mesh);
+	static void Print(const Values & values, std::ostream & os);
+private:
+	Values values;
+	// the stamp and the mesh the values belong to
+	unsigned long long computed;
+	const Mesh* computedmesh;
+};
@@ -0,0 +1,108 @@
+#include <cmath>
+#include <algorithm>
+#include "CameraMath.h"
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+}
+
+CameraMath::Quaternion CameraMath::Quaternion::FromAxisAngle(const OpenMesh::Vec3d & axis, const double & angle)
+{
+	double len = axis.norm();
+	if (len == 0.0)
+	{
+		return Quaternion{ 1.0, 0.0, 0.0, 0.0 };
+	}
+	double half = 0.5 * angle * pi / 180.0;
+	double s = std::sin(half) / len;
+	return Quaternion{ std::cos(half), axis[0] * s, axis[1] * s, axis[2] * s };
+}
+
+void CameraMath::Quaternion::ToMatrix(double* m) const
+{
+	m[0] = 1.0 - 2.0 * (y * y + z * z);
+	m[1] = 2.0 * (x * y + w * z);
+	m[2] = 2.0 * (x * z - w * y);
+	m[3] = 0.0;
+	m[4] = 2.0 * (x * y - w * z);
+	m[5] = 1.0 - 2.0 * (x * x + z * z);
+	m[6] = 2.0 * (y * z + w * x);
+	m[7] = 0.0;
+	m[8] = 2.0 * (x * z + w * y);
+	m[9] = 2.0 * (y * z - w * x);
+	m[10] = 1.0 - 2.0 * (x * x + y * y);
+	m[11] = 0.0;
+	m[12] = m[13] = m[14] = 0.0;
+	m[15] = 1.0;
+}
+
+void CameraMath::Identity(double* m)
+{
+	std::fill(m, m + 16, 0.0);
+	m[0] = m[5] = m[10] = m[15] = 1.0;
+}
+
+void CameraMath::Multiply(const double* a, const double* b, double* m)
+{
+	for (int j = 0; j < 4; ++j)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			m[4 * j + i] = a[i] * b[4 * j] + a[4 + i] * b[4 * j + 1] + a[8 + i] * b[4 * j + 2] + a[12 + i] * b[4 * j + 3];
+		}
+	}
+}
+
+void CameraMath::PreTranslate(const OpenMesh::Vec3d & t, double* m)
+{
+	// only the rows 0-2 change: row_i += t_i * row_3
+	for (int j = 0; j < 4; ++j)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			m[4 * j + i] += t[i] * m[4 * j + 3];
+		}
+	}
+}
+
+void CameraMath::PreRotate(const Quaternion & q, const OpenMesh::Vec3d & c, double* m)
+{
+	double r[16], tmp[16];
+	q.ToMatrix(r);
+	PreTranslate(-c, m);
+	Multiply(r, m, tmp);
+	std::copy(tmp, tmp + 16, m);
+	PreTranslate(c, m);
+}
+
+OpenMesh::Vec3d CameraMath::Transform(const double* m, const OpenMesh::Vec3d & p)
+{
+	return OpenMesh::Vec3d(m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12],
+		m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13],
+		m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
+}
+
+void CameraMath::Frustum(double left, double right, double bottom, double top, double znear, double zfar, double* m)
+{
+	std::fill(m, m + 16, 0.0);
+	m[0] = 2.0 * znear / (right - left);
+	m[5] = 2.0 * znear / (top - bottom);
+	m[8] = (right + left) / (right - left);
+	m[9] = (top + bottom) / (top - bottom);
+	m[10] = -(zfar + znear) / (zfar - znear);
+	m[11] = -1.0;
+	m[14] = -2.0 * zfar * znear / (zfar - znear);
+}
+
+void CameraMath::Ortho(double left, double right, double bottom, double top, double znear, double zfar, double* m)
+{
+	std::fill(m, m + 16, 0.0);
+	m[0] = 2.0 / (right - left);
+	m[5] = 2.0 / (top - bottom);
+	m[10] = -2.0 / (zfar - znear);
+	m[12] = -(right + left) / (right - left);
+	m[13] = -(top + bottom) / (top - bottom);
+	m[14] = -(zfar + znear) / (zfar - znear);
+	m[15] = 1.0;
+}
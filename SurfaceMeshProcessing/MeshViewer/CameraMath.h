@@ -0,0 +1,30 @@
+#pragma once
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+
+// The matrices the viewer used to build on the fixed-function matrix stack,
+//   computed on the CPU. All matrices are 4x4, column-major as OpenGL expects
+//   them, and match the ones glTranslate, glRotate, glFrustum and glOrtho would
+//   produce, so they can be loaded with glLoadMatrixd at draw time.
+class CameraMath
+{
+public:
+	// unit quaternion w + xi + yj + zk
+	struct Quaternion
+	{
+		double w, x, y, z;
+		// rotation by angle degrees around axis, which need not be normalized
+		static Quaternion FromAxisAngle(const OpenMesh::Vec3d & axis, const double & angle);
+		void ToMatrix(double* m) const;
+	};
+	static void Identity(double* m);
+	// m = a * b; m may alias neither a nor b
+	static void Multiply(const double* a, const double* b, double* m);
+	// m = T(t) * m
+	static void PreTranslate(const OpenMesh::Vec3d & t, double* m);
+	// m = T(c) * R(q) * T(-c) * m, a rotation about the eye space point c
+	static void PreRotate(const Quaternion & q, const OpenMesh::Vec3d & c, double* m);
+	// eye space position of the point p
+	static OpenMesh::Vec3d Transform(const double* m, const OpenMesh::Vec3d & p);
+	static void Frustum(double left, double right, double bottom, double top, double znear, double zfar, double* m);
+	static void Ortho(double left, double right, double bottom, double top, double znear, double zfar, double* m);
+};
@@ -28,15 +28,8 @@ void InteractiveViewerWidget::dropEvent(QDropEvent* event)
 	if (fileName.isEmpty())
 		return;
 
-	if (fileName.endsWith(".off") || fileName.endsWith(".obj") || fileName.endsWith(".stl") || fileName.endsWith(".ply"))
+	if (fileName.endsWith(".off") || fileName.endsWith(".obj") || fileName.endsWith(".stl") || fileName.endsWith(".ply") || fileName.endsWith(".smc"))
 	{
-		if (LoadMesh(fileName.toStdString()))
-		{
-			emit(LoadMeshOKSignal(true, fileName));
-		}
-		else
-		{
-			emit(LoadMeshOKSignal(false, "No Mesh"));
-		}
+		LoadMeshAsync(fileName.toStdString());
 	}
 }
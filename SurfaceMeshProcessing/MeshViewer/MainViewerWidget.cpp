@@ -37,19 +37,21 @@ void MainViewerWidget::CreateViewerDialog(void)
 	meshviewerwidget = new InteractiveViewerWidget(NULL);
 	meshviewerwidget->setAcceptDrops(true);
 	connect(meshviewerwidget, SIGNAL(LoadMeshOKSignal(bool, QString)), SLOT(LoadMeshFromInner(bool, QString)));
+	connect(meshviewerwidget, SIGNAL(LoadMeshProgressSignal(QString)), SIGNAL(loadMeshProgress(QString)));
+	connect(meshviewerwidget, SIGNAL(LoadMeshRunningSignal(bool)), SIGNAL(loadMeshRunning(bool)));
 }
 
 void MainViewerWidget::OpenMeshGUI(const QString & fname)
 {
-	if (fname.isEmpty() || !meshviewerwidget->LoadMesh(fname.toStdString()))
+	if (fname.isEmpty())
 	{
 		QString msg = "Cannot read mesh from file:\n '" + fname + "'";
 		QMessageBox::critical(NULL, windowTitle(), msg);
 	}
 	else
 	{
-		loadmeshsuccess = true;
-		emit(haveLoadMesh(fname));
+		// the result arrives in LoadMeshFromInner
+		meshviewerwidget->LoadMeshAsync(fname.toStdString());
 	}
 }
 
@@ -64,8 +66,17 @@ void MainViewerWidget::SaveMeshGUI(const QString & fname)
 
 void MainViewerWidget::LoadMeshFromInner(bool OK, QString fname)
 {
-	loadmeshsuccess = OK;
-	emit(haveLoadMesh(fname));
+	if (OK)
+	{
+		loadmeshsuccess = true;
+		emit(haveLoadMesh(fname));
+	}
+	else
+	{
+		// the previous mesh, if any, is still shown
+		QString msg = "Cannot read mesh from file:\n '" + fname + "'";
+		QMessageBox::critical(NULL, windowTitle(), msg);
+	}
 }
 
 void MainViewerWidget::Open(void)
@@ -73,11 +84,12 @@ void MainViewerWidget::Open(void)
 	QString fileName = QFileDialog::getOpenFileName(this,
 		tr("Open mesh file"),
 		tr(""),
-		tr("Mesh Files (*.obj *.off *.ply *.stl);;"
+		tr("Mesh Files (*.obj *.off *.ply *.stl *.smc);;"
 		"OFF Files (*.off);;"
 		"OBJ Files (*.obj);;"
 		"PLY Files (*.ply);;"
 		"STL Files (*.stl);;"
+		"Mesh Cache Files (*.smc);;"
 		"All Files (*)"));
 	if (!fileName.isEmpty())
 	{
@@ -94,6 +106,7 @@ void MainViewerWidget::Save(void)
 		"OFF Files (*.off);;"
 		"PLY Files (*.ply);;"
 		"STL Files (*.stl);;"
+		"Mesh Cache Files (*.smc);;"
 		"All Files (*)"));
 	if (!fileName.isEmpty())
 	{
@@ -135,6 +148,16 @@ void MainViewerWidget::ShowFlatLines(void)
 	meshviewerwidget->SetDrawMode(InteractiveViewerWidget::FLATLINES);
 }
 
+void MainViewerWidget::Undo(void)
+{
+	meshviewerwidget->Undo();
+}
+
+void MainViewerWidget::Redo(void)
+{
+	meshviewerwidget->Redo();
+}
+
 void MainViewerWidget::ShowFlat(void)
 {
 	meshviewerwidget->SetDrawMode(InteractiveViewerWidget::FLAT);
@@ -165,6 +188,11 @@ void MainViewerWidget::ShowBoundary(bool b)
 	meshviewerwidget->SetDrawBoundary(b);
 }
 
+void MainViewerWidget::CacheMeshes(bool b)
+{
+	meshviewerwidget->SetCacheMeshes(b);
+}
+
 void MainViewerWidget::ResetView(void)
 {
 	meshviewerwidget->ResetView();
@@ -184,3 +212,8 @@ void MainViewerWidget::LoadRotation(void)
 {
 	meshviewerwidget->LoadRotation();
 }
+
+void MainViewerWidget::CancelLoad(void)
+{
+	meshviewerwidget->CancelLoadMesh();
+}
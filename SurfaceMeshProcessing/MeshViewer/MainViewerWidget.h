@@ -25,6 +25,8 @@ protected:
 	void Save(void);
 	void ClearMesh(void);
 	void Screenshot(void);
+	void Undo(void);
+	void Redo(void);
 
 	void ShowPoints(void);
 	void ShowWireframe(void);
@@ -36,13 +38,17 @@ protected:
 	void DoubleSideLighting(bool b);
 	void ShowBoundingBox(bool b);
 	void ShowBoundary(bool b);
+	void CacheMeshes(bool b);
 	void ResetView(void);
 	void ViewCenter(void);
 	void CopyRotation(void);
 	void LoadRotation(void);
+	void CancelLoad(void);
 
 signals:
 	void haveLoadMesh(QString filePath);
+	void loadMeshProgress(QString message);
+	void loadMeshRunning(bool running);
 
 protected:
 	bool loadmeshsuccess;
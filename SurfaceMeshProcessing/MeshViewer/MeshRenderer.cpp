@@ -0,0 +1,569 @@
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <QOpenGLShaderProgram>
+#include "MeshRenderer.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// GLSL 1.20 with the compatibility built-ins, so that the program takes
+	//   the matrices, the color, the material and the lights from the same
+	//   state as the fixed function draws
+	const char* flatlinesvertex =
+		"#version 120\n"
+		"attribute vec3 barycentric;\n"
+		"varying vec3 corner;\n"
+		"varying vec3 normal;\n"
+		"varying vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"	corner = barycentric;\n"
+		"	normal = gl_NormalMatrix * gl_Normal;\n"
+		"	color = gl_Color;\n"
+		"	gl_Position = ftransform();\n"
+		"}\n";
+
+	// lights as directional lights, which are the ones SetDefaultLight sets
+	const char* flatlinesfragment =
+		"#version 120\n"
+		"uniform bool lighting;\n"
+		"uniform bool twoside;\n"
+		"uniform bool lights[8];\n"
+		"uniform vec4 linecolor;\n"
+		"uniform float linewidth;\n"
+		"varying vec3 corner;\n"
+		"varying vec3 normal;\n"
+		"varying vec4 color;\n"
+		"vec4 Shade(vec3 n)\n"
+		"{\n"
+		"	vec4 c = gl_FrontLightModelProduct.sceneColor;\n"
+		"	for (int i = 0; i < 8; ++i)\n"
+		"	{\n"
+		"		if (!lights[i]) continue;\n"
+		"		vec3 l = normalize(gl_LightSource[i].position.xyz);\n"
+		"		float diffuse = max(dot(n, l), 0.0);\n"
+		"		c += gl_FrontLightProduct[i].ambient + gl_FrontLightProduct[i].diffuse * diffuse;\n"
+		"		if (diffuse > 0.0)\n"
+		"		{\n"
+		"			float specular = max(dot(n, normalize(l + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+		"			c += gl_FrontLightProduct[i].specular * pow(specular, gl_FrontMaterial.shininess);\n"
+		"		}\n"
+		"	}\n"
+		"	return vec4(clamp(c.rgb, 0.0, 1.0), gl_FrontMaterial.diffuse.a);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 face = color;\n"
+		"	if (lighting)\n"
+		"	{\n"
+		"		vec3 n = normalize(normal);\n"
+		"		if (twoside && !gl_FrontFacing) n = -n;\n"
+		"		face = Shade(n);\n"
+		"	}\n"
+		"	vec3 a = smoothstep(vec3(0.0), fwidth(corner) * linewidth, corner);\n"
+		"	gl_FragColor = mix(face, linecolor, 1.0 - min(min(a.x, a.y), a.z));\n"
+		"}\n";
+
+	void Allocate(QOpenGLBuffer & buffer, const void* data, size_t size)
+	{
+		buffer.bind();
+		buffer.allocate(data, static_cast<int>(size));
+		buffer.release();
+	}
+}
+
+MeshRenderer::MeshRenderer(void)
+	: dirty(ALL),
+	vertexbuffer(QOpenGLBuffer::VertexBuffer),
+	flatbuffer(QOpenGLBuffer::VertexBuffer),
+	proxybuffer(QOpenGLBuffer::VertexBuffer),
+	nproxy(0),
+	barycentricbuffer(QOpenGLBuffer::VertexBuffer),
+	nbarycentric(0),
+	flatlinesfailed(false),
+	pointindices(QOpenGLBuffer::IndexBuffer),
+	triangleindices(QOpenGLBuffer::IndexBuffer),
+	edgeindices(QOpenGLBuffer::IndexBuffer),
+	boundaryindices(QOpenGLBuffer::IndexBuffer),
+	npoints(0),
+	ntriangles(0),
+	nedges(0),
+	nboundary(0),
+	serial(0),
+	clustered(false),
+	clustersrequested(false),
+	culling(false)
+{
+}
+
+MeshRenderer::~MeshRenderer(void)
+{
+}
+
+void MeshRenderer::Invalidate(const int & flags)
+{
+	dirty |= flags;
+	nproxy = 0;
+}
+
+void MeshRenderer::Update(const Mesh & mesh)
+{
+	if (dirty == 0) return;
+	if (!vertexbuffer.isCreated())
+	{
+		Create(vertexbuffer, vertexvao);
+		Create(flatbuffer, flatvao);
+		Create(proxybuffer, proxyvao);
+		pointindices.create();
+		triangleindices.create();
+		edgeindices.create();
+		boundaryindices.create();
+	}
+	if (dirty & TOPOLOGY)
+	{
+		// ordering the faces takes a sort, too long for a frame
+		clusters.Clear();
+		clusters.faces.reserve(mesh.n_faces());
+		for (const auto & fh : mesh.faces())
+		{
+			clusters.faces.push_back(fh.idx());
+		}
+		clustered = false;
+		clustersrequested = true;
+	}
+	else if (clustered)
+	{
+		clusters.UpdateBounds(mesh);
+	}
+	UploadVertices(mesh);
+	UploadFlat(mesh);
+	if (dirty & TOPOLOGY)
+	{
+		UploadIndices(mesh);
+	}
+	dirty = 0;
+}
+
+void MeshRenderer::Release(void)
+{
+	vertexvao.destroy();
+	flatvao.destroy();
+	proxyvao.destroy();
+	vertexbuffer.destroy();
+	flatbuffer.destroy();
+	proxybuffer.destroy();
+	pointindices.destroy();
+	triangleindices.destroy();
+	edgeindices.destroy();
+	boundaryindices.destroy();
+	barycentricbuffer.destroy();
+	flatlinesprogram.reset();
+	flatlinesfailed = false;
+	npoints = ntriangles = nedges = nboundary = nproxy = nbarycentric = 0;
+	std::vector<GLuint>().swap(pendingtriangles);
+	clusters.Clear();
+	clustered = false;
+	clustersrequested = false;
+	culling = false;
+	dirty = ALL;
+}
+
+void MeshRenderer::DrawPoints(void)
+{
+	Draw(vertexbuffer, vertexvao, &pointindices, GL_POINTS, npoints);
+}
+
+void MeshRenderer::DrawEdges(void)
+{
+	Draw(vertexbuffer, vertexvao, &edgeindices, GL_LINES, nedges);
+}
+
+void MeshRenderer::DrawBoundary(void)
+{
+	Draw(vertexbuffer, vertexvao, &boundaryindices, GL_LINES, nboundary);
+}
+
+void MeshRenderer::DrawFlat(void)
+{
+	Draw(flatbuffer, flatvao, nullptr, GL_TRIANGLES, ntriangles, true);
+}
+
+void MeshRenderer::DrawSmooth(void)
+{
+	Draw(vertexbuffer, vertexvao, &triangleindices, GL_TRIANGLES, ntriangles, true);
+}
+
+bool MeshRenderer::DrawFlatLines(const GLfloat* linecolor, const GLfloat & linewidth)
+{
+	return DrawFlatLines(flatbuffer, flatvao, ntriangles, linecolor, linewidth, true);
+}
+
+void MeshRenderer::SetProxy(const std::vector<float> & points, const std::vector<unsigned int> & triangles)
+{
+	if (!proxybuffer.isCreated()) return;
+	const int nfaces = static_cast<int>(triangles.size() / 3);
+	std::vector<Vertex> vertices(3 * static_cast<size_t>(nfaces));
+	ThreadPool::Global().ParallelBlocks(nfaces, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const float* p[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				p[k] = &points[3 * triangles[3 * i + k]];
+			}
+			GLfloat e1[3], e2[3], n[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				e1[k] = p[1][k] - p[0][k];
+				e2[k] = p[2][k] - p[0][k];
+			}
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			GLfloat length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length > 0.0f)
+			{
+				for (int k = 0; k < 3; ++k) n[k] /= length;
+			}
+			for (int j = 0; j < 3; ++j)
+			{
+				Vertex & v = vertices[3 * i + j];
+				for (int k = 0; k < 3; ++k)
+				{
+					v.position[k] = p[j][k];
+					v.normal[k] = n[k];
+				}
+			}
+		}
+	});
+	Allocate(proxybuffer, vertices.data(), vertices.size() * sizeof(Vertex));
+	nproxy = 3 * nfaces;
+}
+
+bool MeshRenderer::HasProxy(void) const
+{
+	return nproxy > 0;
+}
+
+void MeshRenderer::DrawProxy(void)
+{
+	Draw(proxybuffer, proxyvao, nullptr, GL_TRIANGLES, nproxy);
+}
+
+bool MeshRenderer::DrawProxyLines(const GLfloat* linecolor, const GLfloat & linewidth)
+{
+	return DrawFlatLines(proxybuffer, proxyvao, nproxy, linecolor, linewidth, false);
+}
+
+void MeshRenderer::Cull(const double* modelview, const double* projection, const bool & backfaces)
+{
+	if (!clustered)
+	{
+		cullstats = MeshClusters::CullStats();
+		cullstats.ntriangles = cullstats.ndrawntriangles = static_cast<long long>(clusters.faces.size());
+		culling = false;
+		return;
+	}
+	clusters.Cull(modelview, projection, backfaces, visible, cullstats);
+	culling = true;
+}
+
+void MeshRenderer::NoCull(void)
+{
+	culling = false;
+}
+
+const MeshClusters::CullStats & MeshRenderer::GetCullStats(void) const
+{
+	return cullstats;
+}
+
+bool MeshRenderer::DrawFlatLines(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao, int count, const GLfloat* linecolor, const GLfloat & linewidth, bool cull)
+{
+	if (!CreateFlatLinesProgram()) return false;
+	if (count == 0 || !buffer.isCreated()) return true;
+	if (nbarycentric < count) UploadBarycentric(count);
+	GLint twoside = 0;
+	glGetIntegerv(GL_LIGHT_MODEL_TWO_SIDE, &twoside);
+	GLint lights[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		lights[i] = glIsEnabled(GL_LIGHT0 + i);
+	}
+	flatlinesprogram->bind();
+	flatlinesprogram->setUniformValue("lighting", static_cast<GLint>(glIsEnabled(GL_LIGHTING)));
+	flatlinesprogram->setUniformValue("twoside", twoside);
+	flatlinesprogram->setUniformValueArray("lights", lights, 8);
+	flatlinesprogram->setUniformValue("linecolor", linecolor[0], linecolor[1], linecolor[2], linecolor[3]);
+	flatlinesprogram->setUniformValue("linewidth", linewidth);
+	const int location = flatlinesprogram->attributeLocation("barycentric");
+	Bind(buffer, vao);
+	// enabled only for this draw, the location may alias a fixed function array
+	barycentricbuffer.bind();
+	flatlinesprogram->enableAttributeArray(location);
+	flatlinesprogram->setAttributeBuffer(location, GL_UNSIGNED_BYTE, 0, 3, 4);
+	Submit(nullptr, GL_TRIANGLES, count, cull);
+	flatlinesprogram->disableAttributeArray(location);
+	barycentricbuffer.release();
+	Unbind(buffer, vao);
+	flatlinesprogram->release();
+	return true;
+}
+
+bool MeshRenderer::TakeClusterRequest(int & serial)
+{
+	if (!clustersrequested) return false;
+	clustersrequested = false;
+	serial = this->serial;
+	return true;
+}
+
+void MeshRenderer::SetClusters(const MeshClusters & clusters, const Mesh & mesh, const int & serial)
+{
+	if (serial != this->serial || (dirty & TOPOLOGY) || !triangleindices.isCreated()) return;
+	this->clusters = clusters;
+	clustered = true;
+	UploadFlat(mesh);
+	UploadTriangles(mesh);
+}
+
+bool MeshRenderer::TakeTriangleIndices(std::vector<GLuint> & indices, int & serial)
+{
+	if (pendingtriangles.empty()) return false;
+	indices.swap(pendingtriangles);
+	std::vector<GLuint>().swap(pendingtriangles);
+	serial = this->serial;
+	return true;
+}
+
+void MeshRenderer::SetTriangleIndices(const std::vector<GLuint> & indices, const int & serial)
+{
+	if (serial != this->serial || !triangleindices.isCreated()) return;
+	Allocate(triangleindices, indices.data(), indices.size() * sizeof(GLuint));
+}
+
+void MeshRenderer::UploadVertices(const Mesh & mesh)
+{
+	const int nvertices = static_cast<int>(mesh.n_vertices());
+	std::vector<Vertex> vertices(nvertices);
+	ThreadPool::Global().ParallelBlocks(nvertices, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::VertexHandle vh(i);
+			const auto & p = mesh.point(vh);
+			const auto & n = mesh.normal(vh);
+			for (int k = 0; k < 3; ++k)
+			{
+				vertices[i].position[k] = static_cast<GLfloat>(p[k]);
+				vertices[i].normal[k] = static_cast<GLfloat>(n[k]);
+			}
+		}
+	});
+	Allocate(vertexbuffer, vertices.data(), vertices.size() * sizeof(Vertex));
+}
+
+void MeshRenderer::UploadFlat(const Mesh & mesh)
+{
+	const std::vector<int> & faces = clusters.faces;
+	const int nfaces = static_cast<int>(faces.size());
+	std::vector<Vertex> vertices(3 * faces.size());
+	ThreadPool::Global().ParallelBlocks(nfaces, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Mesh::FaceHandle fh(faces[i]);
+			const auto & n = mesh.normal(fh);
+			Vertex* v = &vertices[3 * i];
+			for (const auto & fvh : mesh.fv_range(fh))
+			{
+				const auto & p = mesh.point(fvh);
+				for (int k = 0; k < 3; ++k)
+				{
+					v->position[k] = static_cast<GLfloat>(p[k]);
+					v->normal[k] = static_cast<GLfloat>(n[k]);
+				}
+				++v;
+			}
+		}
+	});
+	Allocate(flatbuffer, vertices.data(), vertices.size() * sizeof(Vertex));
+	ntriangles = 3 * nfaces;
+}
+
+void MeshRenderer::UploadIndices(const Mesh & mesh)
+{
+	std::vector<GLuint> indices;
+	indices.reserve(mesh.n_vertices());
+	for (const auto & vh : mesh.vertices())
+	{
+		indices.push_back(vh.idx());
+	}
+	Allocate(pointindices, indices.data(), indices.size() * sizeof(GLuint));
+	npoints = static_cast<int>(indices.size());
+
+	UploadTriangles(mesh);
+	++serial;
+
+	std::vector<GLuint> boundary;
+	indices.clear();
+	indices.reserve(2 * mesh.n_edges());
+	for (const auto & eh : mesh.edges())
+	{
+		auto heh = mesh.halfedge_handle(eh, 0);
+		GLuint v0 = mesh.from_vertex_handle(heh).idx();
+		GLuint v1 = mesh.to_vertex_handle(heh).idx();
+		indices.push_back(v0);
+		indices.push_back(v1);
+		if (mesh.is_boundary(eh))
+		{
+			boundary.push_back(v0);
+			boundary.push_back(v1);
+		}
+	}
+	Allocate(edgeindices, indices.data(), indices.size() * sizeof(GLuint));
+	nedges = static_cast<int>(indices.size());
+	Allocate(boundaryindices, boundary.data(), boundary.size() * sizeof(GLuint));
+	nboundary = static_cast<int>(boundary.size());
+}
+
+void MeshRenderer::UploadTriangles(const Mesh & mesh)
+{
+	const std::vector<int> & faces = clusters.faces;
+	const int nfaces = static_cast<int>(faces.size());
+	std::vector<GLuint> indices(3 * faces.size(), 0);
+	ThreadPool::Global().ParallelBlocks(nfaces, true, [&](int, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			GLuint* idx = &indices[3 * i];
+			for (const auto & fvh : mesh.fv_range(Mesh::FaceHandle(faces[i])))
+			{
+				*idx++ = fvh.idx();
+			}
+		}
+	});
+	Allocate(triangleindices, indices.data(), indices.size() * sizeof(GLuint));
+	// the vertex cache order keeps each triangle in its cluster, so it waits
+	//   for them
+	if (clustered)
+	{
+		pendingtriangles.swap(indices);
+	}
+	else
+	{
+		std::vector<GLuint>().swap(pendingtriangles);
+	}
+}
+
+void MeshRenderer::UploadBarycentric(int count)
+{
+	// normalized bytes, padded to four for the alignment of the attribute
+	std::vector<GLubyte> barycentric(4 * static_cast<size_t>(count), 0);
+	for (size_t i = 0; i < barycentric.size(); i += 4)
+	{
+		barycentric[i + (i / 4) % 3] = 255;
+	}
+	if (!barycentricbuffer.isCreated()) barycentricbuffer.create();
+	Allocate(barycentricbuffer, barycentric.data(), barycentric.size());
+	nbarycentric = count;
+}
+
+bool MeshRenderer::CreateFlatLinesProgram(void)
+{
+	if (flatlinesprogram) return true;
+	if (flatlinesfailed) return false;
+	std::unique_ptr<QOpenGLShaderProgram> program(new QOpenGLShaderProgram);
+	if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, flatlinesvertex)
+		|| !program->addShaderFromSourceCode(QOpenGLShader::Fragment, flatlinesfragment)
+		|| !program->link())
+	{
+		std::cerr << "  Warning! Flat lines shader unavailable, drawing the edges in a second pass:\n"
+			<< program->log().toStdString() << std::endl;
+		flatlinesfailed = true;
+		return false;
+	}
+	flatlinesprogram = std::move(program);
+	return true;
+}
+
+void MeshRenderer::Create(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao)
+{
+	buffer.create();
+	// without vertex array objects the arrays are set up on every draw
+	if (vao.create())
+	{
+		vao.bind();
+		SetupArrays(buffer);
+		vao.release();
+		buffer.release();
+	}
+}
+
+void MeshRenderer::SetupArrays(QOpenGLBuffer & buffer)
+{
+	buffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, position)));
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glNormalPointer(GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, normal)));
+}
+
+void MeshRenderer::Bind(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao)
+{
+	if (vao.isCreated())
+	{
+		vao.bind();
+	}
+	else
+	{
+		SetupArrays(buffer);
+	}
+}
+
+void MeshRenderer::Unbind(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao)
+{
+	if (vao.isCreated())
+	{
+		vao.release();
+	}
+	else
+	{
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisableClientState(GL_NORMAL_ARRAY);
+		buffer.release();
+	}
+}
+
+void MeshRenderer::Draw(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao, QOpenGLBuffer* indices, GLenum mode, int count, bool cull)
+{
+	if (count == 0 || !buffer.isCreated()) return;
+	Bind(buffer, vao);
+	Submit(indices, mode, count, cull);
+	Unbind(buffer, vao);
+}
+
+void MeshRenderer::Submit(QOpenGLBuffer* indices, GLenum mode, int count, bool cull)
+{
+	// the visible ranges are in triangles, three vertices or indices each
+	std::vector<std::pair<int, int>> all;
+	if (!cull || !culling) all.emplace_back(0, count);
+	const std::vector<std::pair<int, int>> & ranges = cull && culling ? visible : all;
+	const int scale = cull && culling ? 3 : 1;
+	if (indices) indices->bind();
+	for (const auto & range : ranges)
+	{
+		if (indices)
+		{
+			glDrawElements(mode, scale * range.second, GL_UNSIGNED_INT, reinterpret_cast<const void*>(sizeof(GLuint) * scale * range.first));
+		}
+		else
+		{
+			glDrawArrays(mode, scale * range.first, scale * range.second);
+		}
+	}
+	if (indices) indices->release();
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include "MeshDefinition.h"
+#include "MeshClusters.h"
+class QOpenGLShaderProgram;
+
+// GPU-resident copies of a mesh for the viewer's draw modes. Update uploads
+//   only the buffers invalidated since the last call, so an unchanged mesh
+//   costs one draw call per mode and frame, or one per run of visible
+//   clusters when culling. The faces are uploaded in their own order and
+//   drawn unculled until SetClusters hands in their MeshClusters, then
+//   uploaded again in cluster order. Update, Release, SetClusters and the
+//   Draw functions need the widget's OpenGL context to be current.
+class MeshRenderer
+{
+public:
+	enum DirtyFlag { GEOMETRY = 1, TOPOLOGY = 2, ALL = GEOMETRY | TOPOLOGY };
+	MeshRenderer(void);
+	~MeshRenderer(void);
+	MeshRenderer(const MeshRenderer &) = delete;
+	MeshRenderer & operator=(const MeshRenderer &) = delete;
+	// GEOMETRY after points or normals changed, TOPOLOGY after elements were
+	//   added or deleted
+	void Invalidate(const int & flags = ALL);
+	void Update(const Mesh & mesh);
+	void Release(void);
+	void DrawPoints(void);
+	void DrawEdges(void);
+	void DrawBoundary(void);
+	void DrawFlat(void);
+	void DrawSmooth(void);
+	// The faces of DrawFlat in the current color, or lit like the fixed
+	//   function pipeline would if GL_LIGHTING is enabled, with anti-aliased
+	//   edges in linecolor drawn by the same pass from the barycentric
+	//   coordinates of the corners; linewidth is the width in pixels of the
+	//   edge band inside each face. False, and nothing drawn, if the context
+	//   cannot compile the shader.
+	bool DrawFlatLines(const GLfloat* linecolor, const GLfloat & linewidth);
+	// A coarse stand-in for the mesh to draw while the view moves (see
+	//   MeshProxy), from x, y, z per vertex and three indices per triangle.
+	//   It is flat shaded like DrawFlat and DrawFlatLines draw the mesh, and
+	//   kept until SetProxy is called again or Invalidate drops it.
+	void SetProxy(const std::vector<float> & points, const std::vector<unsigned int> & triangles);
+	bool HasProxy(void) const;
+	void DrawProxy(void);
+	bool DrawProxyLines(const GLfloat* linecolor, const GLfloat & linewidth);
+	// Restricts DrawFlat, DrawSmooth and DrawFlatLines to the clusters that
+	//   may be visible with these matrices until the next Cull or NoCull; see
+	//   MeshClusters::Cull for backfaces. Everything is drawn while there are
+	//   no clusters yet.
+	void Cull(const double* modelview, const double* projection, const bool & backfaces);
+	void NoCull(void);
+	// of the last Cull
+	const MeshClusters::CullStats & GetCullStats(void) const;
+	// True once for each topology upload, so that its MeshClusters can be
+	//   built off the GUI thread; serial identifies the upload.
+	bool TakeClusterRequest(int & serial);
+	// Uploads the faces again in the order of clusters, built for mesh by
+	//   MeshClusters::Build, and culls by them from then on; ignored if the
+	//   topology was uploaded again since serial or is about to be.
+	void SetClusters(const MeshClusters & clusters, const Mesh & mesh, const int & serial);
+	// The triangle indices of the last clustered upload, handed out once so
+	//   that they can be reordered off the GUI thread (see VertexCache);
+	//   serial identifies the upload. False if there are none to hand out.
+	bool TakeTriangleIndices(std::vector<GLuint> & indices, int & serial);
+	// Replaces the indices DrawSmooth uses by a reordering of the same
+	//   triangles that keeps every triangle in its cluster, as
+	//   VertexCache::OptimizeClusters does; ignored if the topology was
+	//   uploaded again since serial.
+	void SetTriangleIndices(const std::vector<GLuint> & indices, const int & serial);
+private:
+	struct Vertex
+	{
+		GLfloat position[3];
+		GLfloat normal[3];
+	};
+	void UploadVertices(const Mesh & mesh);
+	void UploadFlat(const Mesh & mesh);
+	void UploadIndices(const Mesh & mesh);
+	void UploadTriangles(const Mesh & mesh);
+	void UploadBarycentric(int count);
+	bool CreateFlatLinesProgram(void);
+	bool DrawFlatLines(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao, int count, const GLfloat* linecolor, const GLfloat & linewidth, bool cull);
+	void Create(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao);
+	void SetupArrays(QOpenGLBuffer & buffer);
+	void Bind(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao);
+	void Unbind(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao);
+	void Draw(QOpenGLBuffer & buffer, QOpenGLVertexArrayObject & vao, QOpenGLBuffer* indices, GLenum mode, int count, bool cull = false);
+	// the draw calls, with the buffers bound; cull draws the visible
+	//   clusters of the mesh triangles only
+	void Submit(QOpenGLBuffer* indices, GLenum mode, int count, bool cull);
+private:
+	int dirty;
+	// one vertex per mesh vertex with its vertex normal
+	QOpenGLBuffer vertexbuffer;
+	QOpenGLVertexArrayObject vertexvao;
+	// three vertices per face with the face normal, for flat shading
+	QOpenGLBuffer flatbuffer;
+	QOpenGLVertexArrayObject flatvao;
+	// the proxy, laid out like flatbuffer
+	QOpenGLBuffer proxybuffer;
+	QOpenGLVertexArrayObject proxyvao;
+	int nproxy;
+	// the barycentric coordinates of the corners of flatbuffer or proxybuffer,
+	//   grown on the first DrawFlatLines that needs more
+	QOpenGLBuffer barycentricbuffer;
+	int nbarycentric;
+	std::unique_ptr<QOpenGLShaderProgram> flatlinesprogram;
+	// set once the program failed to build, so it is not tried every frame
+	bool flatlinesfailed;
+	QOpenGLBuffer pointindices;
+	QOpenGLBuffer triangleindices;
+	QOpenGLBuffer edgeindices;
+	QOpenGLBuffer boundaryindices;
+	int npoints;
+	int ntriangles;
+	int nedges;
+	int nboundary;
+	// counts the topology uploads
+	int serial;
+	// the live faces in face order until clustered, see SetClusters
+	MeshClusters clusters;
+	bool clustered;
+	bool clustersrequested;
+	// the visible triangle ranges of the last Cull, if culling
+	bool culling;
+	std::vector<std::pair<int, int>> visible;
+	MeshClusters::CullStats cullstats;
+	std::vector<GLuint> pendingtriangles;
+};
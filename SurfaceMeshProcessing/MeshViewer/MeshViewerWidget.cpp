@@ -1,93 +1,429 @@
 #include <QtCore>
 #include <OpenMesh/Core/IO/MeshIO.hh>
 #include "MeshViewerWidget.h"
+#include "VertexCache.h"
+#include "MeshProxy.h"
+
+struct MeshViewerWidget::VertexCacheJob
+{
+	std::vector<GLuint> indices;
+	int serial = 0;
+	int nvertices = 0;
+	std::atomic<bool> cancelled{ false };
+	bool ok = false;
+	double acmr[2] = { 0.0, 0.0 };
+	double atvr[2] = { 0.0, 0.0 };
+};
+
+struct MeshViewerWidget::ClusterJob
+{
+	std::shared_ptr<const Mesh> mesh;
+	int serial = 0;
+	MeshClusters clusters;
+};
+
+struct MeshViewerWidget::ProxyJob
+{
+	std::shared_ptr<const Mesh> mesh;
+	int target = 0;
+	std::vector<float> points;
+	std::vector<unsigned int> triangles;
+	std::atomic<bool> cancelled{ false };
+	bool ok = false;
+};
 
 MeshViewerWidget::MeshViewerWidget(QWidget* parent)
 	: QGLViewerWidget(parent),
+	mesh(std::make_shared<Mesh>()),
 	ptMin(0.0),
 	ptMax(0.0),
 	isEnableLighting(true),
 	isTwoSideLighting(false),
 	isDrawBoundingBox(false),
-	isDrawBoundary(false)
+	isDrawBoundary(false),
+	isCacheMeshes(false),
+	loadthread(nullptr),
+	loadtimer(new QTimer(this)),
+	cachethread(nullptr),
+	clusterthread(nullptr),
+	lodtriangles(1 << 20),
+	lodframetime(0.0),
+	fullframetime(0.0),
+	proxytarget(0),
+	drawproxy(false),
+	proxythread(nullptr)
 {
+	connect(loadtimer, &QTimer::timeout, this, &MeshViewerWidget::ReportLoadProgress);
 }
 
 MeshViewerWidget::~MeshViewerWidget(void)
 {
+	if (loadthread)
+	{
+		loadprogress->cancelled = true;
+		loadthread->wait();
+	}
+	CancelVertexCache();
+	CancelClusters();
+	CancelProxy();
+	ReleaseGL();
+	if (context()) disconnect(context(), nullptr, this, nullptr);
+}
+
+void MeshViewerWidget::initializeGL(void)
+{
+	QGLViewerWidget::initializeGL();
+	// the context is recreated when the widget moves to another window
+	connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &MeshViewerWidget::ReleaseGL);
+}
+
+void MeshViewerWidget::ReleaseGL(void)
+{
+	if (!context()) return;
+	makeCurrent();
+	renderer.Release();
+	proxytarget = 0;
+	doneCurrent();
 }
 
 bool MeshViewerWidget::LoadMesh(const std::string & filename)
 {
-	Clear();
-	bool read_OK = MeshTools::ReadMesh(mesh, filename);
+	auto newmesh = std::make_shared<Mesh>();
+	bool read_OK = MeshTools::ReadMesh(*newmesh, filename, MeshTools::OBJ_PARALLEL, isCacheMeshes);
 	std::cout << "Load mesh from file " << filename << std::endl;
 	if (read_OK)
 	{
+		mesh = newmesh;
+		history.Clear();
 		strMeshFileName = QString::fromStdString(filename);
 		QFileInfo fi(strMeshFileName);
 		strMeshPath = fi.path();
 		strMeshBaseName = fi.baseName();
 		UpdateMesh();
-		update();
+		RequestFrame();
 		return true;
 	}
 	return false;
 }
 
-void MeshViewerWidget::Clear(void)
+void MeshViewerWidget::LoadMeshAsync(const std::string & filename)
+{
+	if (loadthread)
+	{
+		// only the latest request is kept; the superseded thread is cancelled
+		//   and left to finish on its own, it only touches its shared state
+		CancelLoadMesh();
+		loadthread = nullptr;
+	}
+	auto progress = std::make_shared<LoadProgress>();
+	auto newmesh = std::make_shared<Mesh>();
+	auto read_OK = std::make_shared<bool>(false);
+	loadprogress = progress;
+	loadedmesh = newmesh;
+	loadfilename = QString::fromStdString(filename);
+	const bool usecache = isCacheMeshes;
+	loadthread = QThread::create([progress, newmesh, read_OK, filename, usecache]()
+	{
+		*read_OK = MeshTools::ReadMesh(*newmesh, filename, MeshTools::OBJ_PARALLEL, usecache, progress.get());
+	});
+	// a superseded load still delivers finished; it is recognised by its progress
+	connect(loadthread, &QThread::finished, this, [this, progress, read_OK]()
+	{
+		if (progress == loadprogress) FinishLoadMesh(*read_OK);
+	});
+	connect(loadthread, &QThread::finished, loadthread, &QObject::deleteLater);
+	loadthread->start();
+	loadtimer->start(100);
+	emit(LoadMeshRunningSignal(true));
+	ReportLoadProgress();
+}
+
+void MeshViewerWidget::CancelLoadMesh(void)
+{
+	if (loadthread)
+	{
+		loadprogress->cancelled = true;
+	}
+}
+
+bool MeshViewerWidget::IsLoadingMesh(void) const
 {
-	mesh.clear();
+	return loadthread != nullptr;
 }
 
-void MeshViewerWidget::UpdateMesh(void)
+void MeshViewerWidget::SetCacheMeshes(bool b)
 {
-	mesh.update_normals();
-	if (mesh.vertices_empty())
+	isCacheMeshes = b;
+}
+
+void MeshViewerWidget::FinishLoadMesh(bool read_OK)
+{
+	loadtimer->stop();
+	loadthread = nullptr;
+	bool cancelled = loadprogress->cancelled;
+	QString filename = loadfilename;
+	std::shared_ptr<Mesh> newmesh;
+	newmesh.swap(loadedmesh);
+	loadprogress.reset();
+	emit(LoadMeshRunningSignal(false));
+	if (cancelled)
 	{
-		std::cerr << "ERROR: UpdateMesh() No vertices!" << std::endl;
+		std::cout << "Loading of " << filename.toStdString() << " cancelled" << std::endl;
+		emit(LoadMeshProgressSignal("Loading cancelled"));
 		return;
 	}
-	ptMin[0] = ptMin[1] = ptMin[2] = DBL_MAX;
-	ptMax[0] = ptMax[1] = ptMax[2] = -DBL_MAX;
-	for (const auto& vh : mesh.vertices())
+	std::cout << "Load mesh from file " << filename.toStdString() << std::endl;
+	if (read_OK)
 	{
-		ptMin.minimize(mesh.point(vh));
-		ptMax.maximize(mesh.point(vh));
+		mesh = newmesh;
+		history.Clear();
+		strMeshFileName = filename;
+		QFileInfo fi(strMeshFileName);
+		strMeshPath = fi.path();
+		strMeshBaseName = fi.baseName();
+		// the normals were computed on the loading thread
+		UpdateMesh(false);
+		RequestFrame();
 	}
+	emit(LoadMeshOKSignal(read_OK, filename));
+}
 
-	double avelen = 0.0;
-	double maxlen = 0.0;
-	double minlen = DBL_MAX;
-	for (const auto& eh : mesh.edges())
+void MeshViewerWidget::ReportLoadProgress(void)
+{
+	if (!loadprogress) return;
+	const LoadProgress & p = *loadprogress;
+	QString msg = "Loading " + QFileInfo(loadfilename).fileName() + "...";
+	if (p.bytestotal > 0)
+	{
+		msg += QString("  parsed %1 / %2 MB").arg(p.bytesparsed / 1048576).arg(p.bytestotal / 1048576);
+	}
+	if (p.facestotal > 0)
 	{
-		double len = mesh.calc_edge_length(eh);
-		maxlen = len > maxlen ? len : maxlen;
-		minlen = len < minlen ? len : minlen;
-		avelen += len;
+		msg += QString("  built %1 / %2 faces").arg(p.facesbuilt).arg(p.facestotal);
 	}
+	emit(LoadMeshProgressSignal(msg));
+}
+
+void MeshViewerWidget::OptimizeVertexCache(void)
+{
+	// the first frames draw in face order; the reordered indices replace
+	//   them when ready, unless the topology was uploaded again meanwhile
+	auto job = std::make_shared<VertexCacheJob>();
+	if (!renderer.TakeTriangleIndices(job->indices, job->serial)) return;
+	CancelVertexCache();
+	job->nvertices = static_cast<int>(mesh->n_vertices());
+	cachejob = job;
+	cachethread = QThread::create([job]()
+	{
+		VertexCache::Measure(job->indices, job->nvertices, VertexCache::maxcachesize, job->acmr[0], job->atvr[0]);
+		job->ok = VertexCache::OptimizeClusters(job->indices, MeshClusters::clustersize, &job->cancelled);
+		if (job->ok)
+		{
+			VertexCache::Measure(job->indices, job->nvertices, VertexCache::maxcachesize, job->acmr[1], job->atvr[1]);
+		}
+	});
+	connect(cachethread, &QThread::finished, this, [this, job]()
+	{
+		if (job != cachejob) return;
+		cachethread->deleteLater();
+		cachethread = nullptr;
+		cachejob.reset();
+		if (!job->ok) return;
+		std::cout << "Vertex cache: ACMR " << job->acmr[0] << " -> " << job->acmr[1]
+			<< ", ATVR " << job->atvr[0] << " -> " << job->atvr[1] << std::endl;
+		makeCurrent();
+		renderer.SetTriangleIndices(job->indices, job->serial);
+		doneCurrent();
+		RequestFrame();
+	});
+	cachethread->start();
+}
+
+void MeshViewerWidget::CancelVertexCache(void)
+{
+	if (!cachethread) return;
+	cachejob->cancelled = true;
+	cachethread->wait();
+	cachethread->deleteLater();
+	cachethread = nullptr;
+	cachejob.reset();
+}
+
+void MeshViewerWidget::BuildClusters(void)
+{
+	// the first frames draw every face in face order; the clusters replace
+	//   that when ready, unless the topology was uploaded again meanwhile
+	int serial = 0;
+	if (!renderer.TakeClusterRequest(serial)) return;
+	CancelClusters();
+	auto job = std::make_shared<ClusterJob>();
+	job->mesh = mesh;
+	job->serial = serial;
+	clusterjob = job;
+	clusterthread = QThread::create([job]()
+	{
+		job->clusters.Build(*job->mesh);
+	});
+	connect(clusterthread, &QThread::finished, this, [this, job]()
+	{
+		if (job != clusterjob) return;
+		clusterthread->deleteLater();
+		clusterthread = nullptr;
+		clusterjob.reset();
+		makeCurrent();
+		renderer.SetClusters(job->clusters, *job->mesh, job->serial);
+		doneCurrent();
+		RequestFrame();
+	});
+	clusterthread->start();
+}
+
+void MeshViewerWidget::CancelClusters(void)
+{
+	// the build cannot be interrupted, it is a few sorts
+	if (!clusterthread) return;
+	clusterthread->wait();
+	clusterthread->deleteLater();
+	clusterthread = nullptr;
+	clusterjob.reset();
+}
+
+void MeshViewerWidget::CancelProxy(void)
+{
+	if (!proxythread) return;
+	proxyjob->cancelled = true;
+	proxythread->wait();
+	proxythread->deleteLater();
+	proxythread = nullptr;
+	proxyjob.reset();
+}
+
+int MeshViewerWidget::ProxyTarget(void) const
+{
+	const int nfaces = static_cast<int>(mesh->n_faces());
+	if (lodtriangles <= 0) return 0;
+	if (lodframetime <= 0.0) return nfaces > lodtriangles ? lodtriangles : 0;
+	if (fullframetime <= lodframetime) return 0;
+	return std::min(lodtriangles, static_cast<int>(nfaces * (lodframetime / fullframetime)));
+}
+
+void MeshViewerWidget::BuildProxy(void)
+{
+	// built again when the wanted size moved by half or more
+	const int target = ProxyTarget();
+	if (target == 0 || proxythread) return;
+	if (proxytarget > 0 && 2 * target < 3 * proxytarget && 2 * proxytarget < 3 * target) return;
+	auto job = std::make_shared<ProxyJob>();
+	job->mesh = mesh;
+	job->target = target;
+	proxyjob = job;
+	proxythread = QThread::create([job]()
+	{
+		job->ok = MeshProxy::Cluster(*job->mesh, job->target, job->points, job->triangles, &job->cancelled);
+	});
+	connect(proxythread, &QThread::finished, this, [this, job]()
+	{
+		if (job != proxyjob) return;
+		proxythread->deleteLater();
+		proxythread = nullptr;
+		proxyjob.reset();
+		if (!job->ok) return;
+		proxytarget = job->target;
+		std::cout << "Interaction proxy: " << job->triangles.size() / 3 << " triangles" << std::endl;
+		makeCurrent();
+		renderer.SetProxy(job->points, job->triangles);
+		doneCurrent();
+		if (IsInteracting()) RequestFrame();
+	});
+	proxythread->start();
+}
+
+void MeshViewerWidget::SetInteractionLOD(const int & triangles, const double & milliseconds)
+{
+	CancelProxy();
+	lodtriangles = triangles;
+	lodframetime = milliseconds;
+	fullframetime = 0.0;
+	proxytarget = 0;
+	RequestFrame();
+}
 
-	SetScenePosition((ptMin + ptMax)*0.5, (ptMin - ptMax).norm()*0.5);
+void MeshViewerWidget::Clear(void)
+{
+	CancelClusters();
+	CancelProxy();
+	mesh = std::make_shared<Mesh>();
+	history.Clear();
+	renderer.Invalidate();
+	proxytarget = 0;
+	RequestFrame();
+}
+
+void MeshViewerWidget::UpdateMesh(bool updatenormals)
+{
+	// the cluster and proxy jobs read the mesh this was called for
+	CancelClusters();
+	CancelProxy();
+	if (updatenormals) mesh->update_normals();
+	renderer.Invalidate();
+	proxytarget = 0;
+	MeshTools::Modified(*mesh);
+	if (mesh->vertices_empty())
+	{
+		std::cerr << "ERROR: UpdateMesh() No vertices!" << std::endl;
+		return;
+	}
+	const MeshStats::Values & values = stats.Get(*mesh);
+	ptMin = values.bmin;
+	ptMax = values.bmax;
+	SetScenePosition(OpenMesh::Vec3d((ptMin + ptMax)*0.5), (ptMin - ptMax).norm()*0.5);
 	std::cout << "Information of the input mesh:" << std::endl;
-	std::cout << "  [V, E, F] = [" << mesh.n_vertices() << ", " << mesh.n_edges() << ", " << mesh.n_faces() << "]\n";
-	std::cout << "  BoundingBox:\n";
-	std::cout << "  X: [" << ptMin[0] << ", " << ptMax[0] << "]\n";
-	std::cout << "  Y: [" << ptMin[1] << ", " << ptMax[1] << "]\n";
-	std::cout << "  Z: [" << ptMin[2] << ", " << ptMax[2] << "]\n";
-	std::cout << "  Diag length of BBox: " << (ptMax - ptMin).norm() << std::endl;
-	std::cout << "  Edge Length: [" << minlen << ", " << maxlen << "]; AVG: " << avelen / mesh.n_edges() << std::endl;
+	MeshStats::Print(values, std::cout);
+}
+
+void MeshViewerWidget::BeginEdit(void)
+{
+	CancelClusters();
+	CancelProxy();
+	if (history.Empty()) history.Commit(*mesh);
+}
+
+void MeshViewerWidget::EndEdit(void)
+{
+	history.Commit(*mesh);
+	UpdateMesh();
+	RequestFrame();
+}
+
+bool MeshViewerWidget::Undo(void)
+{
+	CancelClusters();
+	CancelProxy();
+	if (!history.Undo(*mesh)) return false;
+	UpdateMesh();
+	RequestFrame();
+	return true;
+}
+
+bool MeshViewerWidget::Redo(void)
+{
+	CancelClusters();
+	CancelProxy();
+	if (!history.Redo(*mesh)) return false;
+	UpdateMesh();
+	RequestFrame();
+	return true;
 }
 
 bool MeshViewerWidget::SaveMesh(const std::string & filename)
 {
-	return MeshTools::WriteMesh(mesh, filename, DBL_DECIMAL_DIG);
+	return MeshTools::WriteMesh(*mesh, filename, DBL_DECIMAL_DIG);
 }
 
 bool MeshViewerWidget::ScreenShot()
 {
-	update();
 	QString filename = strMeshPath + "/" + QDateTime::currentDateTime().toString("yyyyMMddHHmmsszzz") + QString(".png");
-	QImage image = grabFramebuffer();
+	QImage image = GrabFullQuality();
 	image.save(filename);
 	std::cout << "Save screen shot to " << filename.toStdString() << std::endl;
 	return true;
@@ -95,39 +431,44 @@ bool MeshViewerWidget::ScreenShot()
 
 void MeshViewerWidget::SetDrawBoundingBox(bool b)
 {
+	if (isDrawBoundingBox == b) return;
 	isDrawBoundingBox = b;
-	update();
+	RequestFrame();
 }
 void MeshViewerWidget::SetDrawBoundary(bool b)
 {
+	if (isDrawBoundary == b) return;
 	isDrawBoundary = b;
-	update();
+	RequestFrame();
 }
 void MeshViewerWidget::EnableLighting(bool b)
 {
+	if (isEnableLighting == b) return;
 	isEnableLighting = b;
-	update();
+	RequestFrame();
 }
 void MeshViewerWidget::EnableDoubleSide(bool b)
 {
+	if (isTwoSideLighting == b) return;
 	isTwoSideLighting = b;
-	update();
+	RequestFrame();
 }
 
 void MeshViewerWidget::ResetView(void)
 {
 	ResetModelviewMatrix();
 	ViewCenter();
-	update();
+	RequestFrame();
 }
 
 void MeshViewerWidget::ViewCenter(void)
 {
-	if (!mesh.vertices_empty())
+	if (!mesh->vertices_empty())
 	{
-		UpdateMesh();
+		const MeshStats::Values & values = stats.Get(*mesh);
+		SetScenePosition(OpenMesh::Vec3d((values.bmin + values.bmax)*0.5), (values.bmin - values.bmax).norm()*0.5);
 	}
-	update();
+	RequestFrame();
 }
 
 void MeshViewerWidget::CopyRotation(void)
@@ -138,18 +479,21 @@ void MeshViewerWidget::CopyRotation(void)
 void MeshViewerWidget::LoadRotation(void)
 {
 	LoadCopyModelViewMatrix();
-	update();
+	RequestFrame();
 }
 
 void MeshViewerWidget::PrintMeshInfo(void)
 {
 	std::cout << "Mesh Info:\n";
-	std::cout << "  [V, E, F] = [" << mesh.n_vertices() << ", " << mesh.n_edges() << ", " << mesh.n_faces() << "]\n";
-	std::cout << "  BoundingBox:\n";
-	std::cout << "  X: [" << ptMin[0] << ", " << ptMax[0] << "]\n";
-	std::cout << "  Y: [" << ptMin[1] << ", " << ptMax[1] << "]\n";
-	std::cout << "  Z: [" << ptMin[2] << ", " << ptMax[2] << "]\n";
-	std::cout << "  Diag length of BBox: " << (ptMax - ptMin).norm() << std::endl;
+	MeshStats::Print(stats.Get(*mesh), std::cout);
+	const MeshClusters::CullStats & cull = renderer.GetCullStats();
+	std::cout << "  Last frame: drew " << cull.ndrawntriangles << " of " << cull.ntriangles << " faces; Clusters: " << cull.nclusters
+		<< "; Outside the view: " << cull.nfrustumculled << "; Facing away: " << cull.nbackfaceculled << std::endl;
+}
+
+const MeshClusters::CullStats & MeshViewerWidget::GetCullStats(void) const
+{
+	return renderer.GetCullStats();
 }
 
 void MeshViewerWidget::DrawScene(void)
@@ -158,19 +502,42 @@ void MeshViewerWidget::DrawScene(void)
 	glLoadMatrixd(&projectionmatrix[0]);
 	glMatrixMode(GL_MODELVIEW);
 	glLoadMatrixd(&modelviewmatrix[0]);
+	renderer.Update(*mesh);
+	BuildClusters();
+	OptimizeVertexCache();
+	BuildProxy();
+	drawproxy = IsInteracting() && renderer.HasProxy() && ProxyTarget() > 0;
+	// back sides can be seen through the holes of an open mesh, and are lit
+	//   to be seen with double side lighting
+	renderer.Cull(&modelviewmatrix[0], &projectionmatrix[0], !isTwoSideLighting && stats.Get(*mesh).nboundaryedges == 0);
 	//DrawAxis();
 	if (isDrawBoundingBox) DrawBoundingBox();
 	if (isDrawBoundary) DrawBoundary();
 	if (isEnableLighting) glEnable(GL_LIGHTING);
 	glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, isTwoSideLighting);
+	// a still frame, full resolution at full quality, is timed to the end of
+	//   the GPU work
+	QElapsedTimer timer;
+	bool timed = !IsInteracting() && lodtriangles > 0 && lodframetime > 0.0;
+	if (timed) timer.start();
 	DrawSceneMesh();
+	if (timed)
+	{
+		glFinish();
+		fullframetime = timer.nsecsElapsed() * 1e-6;
+	}
 	if (isEnableLighting) glDisable(GL_LIGHTING);
 }
 
 void MeshViewerWidget::DrawSceneMesh(void)
 {
-	if (mesh.n_vertices() == 0) { return; }
+	if (mesh->n_vertices() == 0) { return; }
 	SetMaterial();
+	if (drawproxy)
+	{
+		DrawProxy();
+		return;
+	}
 	switch (drawmode)
 	{
 	case POINTS:
@@ -197,42 +564,33 @@ void MeshViewerWidget::DrawSceneMesh(void)
 	}
 }
 
-void MeshViewerWidget::DrawPoints(void) const
+void MeshViewerWidget::DrawPoints(void)
 {
 	glColor3d(1.0, 0.5, 0.5);
 	glPointSize(5);
-	glBegin(GL_POINTS);
-	for (const auto& vh : mesh.vertices())
-	{
-		glNormal3dv(mesh.normal(vh).data());
-		glVertex3dv(mesh.point(vh).data());
-	}
-	glEnd();
+	renderer.DrawPoints();
 }
 
-void MeshViewerWidget::DrawWireframe(void) const
+void MeshViewerWidget::DrawWireframe(void)
 {
 	glColor3d(0.2, 0.2, 0.2);
-	glBegin(GL_LINES);
-	for (const auto& eh : mesh.edges())
-	{
-		auto heh = mesh.halfedge_handle(eh, 0);
-		auto vh0 = mesh.from_vertex_handle(heh);
-		auto vh1 = mesh.to_vertex_handle(heh);
-		glNormal3dv(mesh.normal(vh0).data());
-		glVertex3dv(mesh.point(vh0).data());
-		glNormal3dv(mesh.normal(vh1).data());
-		glVertex3dv(mesh.point(vh1).data());
-	}
-	glEnd();
+	renderer.DrawEdges();
 }
 
-void MeshViewerWidget::DrawHiddenLines() const
+void MeshViewerWidget::DrawHiddenLines(void)
 {
 	glLineWidth(1.0);
 	float backcolor[4];
 	glGetFloatv(GL_COLOR_CLEAR_VALUE, backcolor);
 	glColor4fv(backcolor);
+	// faces in the background color and their edges in one pass if the
+	//   renderer has the shader, else the faces and then their outlines
+	const GLfloat linecolor[] = { 0.3f, 0.3f, 0.3f, 1.0f };
+	bool lighting = glIsEnabled(GL_LIGHTING);
+	if (lighting) glDisable(GL_LIGHTING);
+	bool drawn = renderer.DrawFlatLines(linecolor, 1.0f);
+	if (lighting) glEnable(GL_LIGHTING);
+	if (drawn) return;
 	glDepthRange(0.01, 1.0);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	if (glIsEnabled(GL_LIGHTING))
@@ -252,13 +610,16 @@ void MeshViewerWidget::DrawHiddenLines() const
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
-void MeshViewerWidget::DrawFlatLines(void) const
+void MeshViewerWidget::DrawFlatLines(void)
 {
-	glEnable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(1.5f, 2.0f);
 	glShadeModel(GL_FLAT);
 	//glColor3d(0.8, 0.8, 0.8);
 	glColor3d(1.0, 1.0, 1.0);
+	// one pass if the renderer has the shader, with the color of DrawWireframe
+	const GLfloat linecolor[] = { 0.2f, 0.2f, 0.2f, 1.0f };
+	if (renderer.DrawFlatLines(linecolor, 1.0f)) return;
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 2.0f);
 	DrawFlat();
 	glDisable(GL_POLYGON_OFFSET_FILL);
 	if (glIsEnabled(GL_LIGHTING))
@@ -273,40 +634,51 @@ void MeshViewerWidget::DrawFlatLines(void) const
 	}
 }
 
-void MeshViewerWidget::DrawFlat(void) const
+void MeshViewerWidget::DrawFlat(void)
 {
-	glBegin(GL_TRIANGLES);
-	for (const auto& fh : mesh.faces())
-	{
-		glNormal3dv(mesh.normal(fh).data());
-		for (const auto& fvh : mesh.fv_range(fh))
-		{
-			glVertex3dv(mesh.point(fvh).data());
-		}
-	}
-	glEnd();
+	renderer.DrawFlat();
 }
 
-void MeshViewerWidget::DrawSmooth(void) const
+void MeshViewerWidget::DrawSmooth(void)
 {
 	glColor3d(0.8, 0.8, 0.8);
 	glShadeModel(GL_SMOOTH);
-	glLoadName(static_cast<GLuint>(mesh.n_vertices()));
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_DOUBLE, 0, mesh.points());
-	glEnableClientState(GL_NORMAL_ARRAY);
-	glNormalPointer(GL_DOUBLE, 0, mesh.vertex_normals());
-	for (const auto& fh : mesh.faces())
+	glLoadName(static_cast<GLuint>(mesh->n_vertices()));
+	renderer.DrawSmooth();
+}
+
+void MeshViewerWidget::DrawProxy(void)
+{
+	// the modes with edges keep them if the renderer has the shader; the
+	//   others show the shaded proxy, which is cheaper than its points or lines
+	glShadeModel(GL_FLAT);
+	const GLfloat flatlinecolor[] = { 0.2f, 0.2f, 0.2f, 1.0f };
+	const GLfloat hiddenlinecolor[] = { 0.3f, 0.3f, 0.3f, 1.0f };
+	switch (drawmode)
 	{
-		glBegin(GL_POLYGON);
-		for (const auto& fvh : mesh.fv_range(fh))
-		{
-			glArrayElement(fvh.idx());
-		}
-		glEnd();
+	case HIDDENLINES:
+	{
+		float backcolor[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, backcolor);
+		glColor4fv(backcolor);
+		bool lighting = glIsEnabled(GL_LIGHTING);
+		if (lighting) glDisable(GL_LIGHTING);
+		bool drawn = renderer.DrawProxyLines(hiddenlinecolor, 1.0f);
+		if (lighting) glEnable(GL_LIGHTING);
+		if (drawn) break;
+		glColor3d(0.8, 0.8, 0.8);
+		renderer.DrawProxy();
+		break;
+	}
+	case FLATLINES:
+		glColor3d(1.0, 1.0, 1.0);
+		if (!renderer.DrawProxyLines(flatlinecolor, 1.0f)) renderer.DrawProxy();
+		break;
+	default:
+		glColor3d(0.8, 0.8, 0.8);
+		renderer.DrawProxy();
+		break;
 	}
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
 }
 
 void MeshViewerWidget::DrawBoundingBox(void) const
@@ -335,26 +707,12 @@ void MeshViewerWidget::DrawBoundingBox(void) const
 	glLineWidth(linewidth);
 }
 
-void MeshViewerWidget::DrawBoundary(void) const
+void MeshViewerWidget::DrawBoundary(void)
 {
 	float linewidth;
 	glGetFloatv(GL_LINE_WIDTH, &linewidth);
 	glLineWidth(2.0f);
 	glColor3d(0.1, 0.1, 0.1);
-	glBegin(GL_LINES);
-	for (const auto& eh : mesh.edges())
-	{
-		if (mesh.is_boundary(eh))
-		{
-			auto heh = mesh.halfedge_handle(eh, 0);
-			auto vh0 = mesh.from_vertex_handle(heh);
-			auto vh1 = mesh.to_vertex_handle(heh);
-			glNormal3dv(mesh.normal(vh0).data());
-			glVertex3dv(mesh.point(vh0).data());
-			glNormal3dv(mesh.normal(vh1).data());
-			glVertex3dv(mesh.point(vh1).data());
-		}
-	}
-	glEnd();
+	renderer.DrawBoundary();
 	glLineWidth(linewidth);
 }
@@ -1,7 +1,13 @@
 #pragma once
+#include <memory>
 #include <QString>
 #include "QGLViewerWidget.h"
 #include "MeshDefinition.h"
+#include "MeshRenderer.h"
+#include "MeshStats.h"
+#include "MeshHistory.h"
+class QThread;
+class QTimer;
 
 class MeshViewerWidget : public QGLViewerWidget
 {
@@ -10,8 +16,23 @@ public:
 	MeshViewerWidget(QWidget* parent = 0);
 	virtual ~MeshViewerWidget(void);
 	bool LoadMesh(const std::string & filename);
+	// Reads the mesh on a worker thread; the current mesh stays on screen
+	//   until the new one replaces it, and LoadMeshOKSignal reports the result.
+	void LoadMeshAsync(const std::string & filename);
+	void CancelLoadMesh(void);
+	bool IsLoadingMesh(void) const;
+	// With b, loads read and write .smc caches next to the mesh files (see
+	//   MeshTools::ReadMesh); off by default.
+	void SetCacheMeshes(bool b);
 	void Clear(void);
-	void UpdateMesh(void);
+	void UpdateMesh(bool updatenormals = true);
+	// Edits of *mesh in place: BeginEdit before the first change records the
+	//   state to return to, EndEdit records the result and updates the view.
+	//   Loading or clearing the mesh forgets the history.
+	void BeginEdit(void);
+	void EndEdit(void);
+	bool Undo(void);
+	bool Redo(void);
 	bool SaveMesh(const std::string & filename);
 	bool ScreenShot(void);
 	void SetDrawBoundingBox(bool b);
@@ -22,25 +43,52 @@ public:
 	void ViewCenter(void);
 	void CopyRotation(void);
 	void LoadRotation(void);
+	// Level of detail while the view moves: a mesh of more than triangles
+	//   faces is drawn as a proxy of about that many triangles, built in the
+	//   background, from a button press or wheel event until the input has
+	//   been idle for a moment. With milliseconds above 0 the budget is a
+	//   frame time instead: the proxy is used once a full resolution frame
+	//   took longer, and sized from that frame's speed, up to triangles.
+	//   triangles 0 turns it off.
+	void SetInteractionLOD(const int & triangles, const double & milliseconds = 0.0);
+	// The faces are drawn in clusters, and the clusters outside the view,
+	//   or facing away on a closed mesh without double side lighting, are
+	//   skipped; these are the counts of the last frame.
+	const MeshClusters::CullStats & GetCullStats(void) const;
 signals:
 	void LoadMeshOKSignal(bool, QString);
+	void LoadMeshProgressSignal(QString);
+	void LoadMeshRunningSignal(bool);
 public slots:
 	void PrintMeshInfo(void);
 protected:
+	virtual void initializeGL(void) override;
 	virtual void DrawScene(void) override;
 	void DrawSceneMesh(void);
 
 private:
-	void DrawPoints(void) const;
-	void DrawWireframe(void) const;
-	void DrawHiddenLines(void) const;
-	void DrawFlatLines(void) const;
-	void DrawFlat(void) const;
-	void DrawSmooth(void) const;
+	void DrawPoints(void);
+	void DrawWireframe(void);
+	void DrawHiddenLines(void);
+	void DrawFlatLines(void);
+	void DrawFlat(void);
+	void DrawSmooth(void);
 	void DrawBoundingBox(void) const;
-	void DrawBoundary(void) const;
+	void DrawBoundary(void);
+	void DrawProxy(void);
+	void ReleaseGL(void);
+	void FinishLoadMesh(bool read_OK);
+	void ReportLoadProgress(void);
+	void OptimizeVertexCache(void);
+	void CancelVertexCache(void);
+	void BuildClusters(void);
+	void CancelClusters(void);
+	int ProxyTarget(void) const;
+	void BuildProxy(void);
+	void CancelProxy(void);
 protected:
-	Mesh mesh;
+	// replaced as a whole when a new mesh is loaded
+	std::shared_ptr<Mesh> mesh;
 	QString strMeshFileName;
 	QString strMeshBaseName;
 	QString strMeshPath;
@@ -50,4 +98,39 @@ protected:
 	bool isTwoSideLighting;
 	bool isDrawBoundingBox;
 	bool isDrawBoundary;
+	bool isCacheMeshes;
+	// buffers of the current mesh; UpdateMesh marks them for re-upload
+	MeshRenderer renderer;
+	// cached statistics of the current mesh, recomputed once its stamp of
+	//   MeshTools::Modified changes; UpdateMesh stamps it
+	MeshStats stats;
+	// the edits of the current mesh that can be undone or redone
+	MeshHistory history;
+private:
+	QThread* loadthread;
+	QTimer* loadtimer;
+	std::shared_ptr<LoadProgress> loadprogress;
+	std::shared_ptr<Mesh> loadedmesh;
+	QString loadfilename;
+	// reorders the triangles of the last upload for the vertex cache
+	struct VertexCacheJob;
+	QThread* cachethread;
+	std::shared_ptr<VertexCacheJob> cachejob;
+	// orders the faces of the last upload into clusters for culling
+	struct ClusterJob;
+	QThread* clusterthread;
+	std::shared_ptr<ClusterJob> clusterjob;
+	// see SetInteractionLOD
+	int lodtriangles;
+	double lodframetime;
+	// milliseconds of the last still frame, at full resolution and quality,
+	//   measured while lodframetime is set
+	double fullframetime;
+	// the size the proxy was built for, 0 until it is built for this mesh
+	int proxytarget;
+	// set in DrawScene when this frame draws the proxy
+	bool drawproxy;
+	struct ProxyJob;
+	QThread* proxythread;
+	std::shared_ptr<ProxyJob> proxyjob;
 };
@@ -5,10 +5,31 @@
 #include <QMouseEvent>
 #include <QDesktopWidget>
 #include <QScreen>
+#include <QTimer>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLTimerQuery>
 #include "QGLViewerWidget.h"
+#include "CameraMath.h"
 #include <QOpenGLTexture>
+#include <algorithm>
 
 const double QGLViewerWidget::trackballradius = 0.6;
+const int QGLViewerWidget::interactionidle = 250;
+const int QGLViewerWidget::backgroundinterval = 100;
+// fewer samples first, they cost fill rate without changing the picture
+//   much, then fewer pixels
+const QGLViewerWidget::RenderQuality QGLViewerWidget::qualitylevels[] = {
+	{ 1.0, -1, true },
+	{ 1.0, 4, false },
+	{ 1.0, 0, false },
+	{ 0.75, 0, false },
+	{ 0.5, 0, false }
+};
+const int QGLViewerWidget::nqualitylevels = sizeof(qualitylevels) / sizeof(qualitylevels[0]);
+const int QGLViewerWidget::qualityraiseframes = 10;
+const int QGLViewerWidget::nframequeries = 4;
 
 QGLViewerWidget::QGLViewerWidget(QWidget* _parent)
 	: QOpenGLWidget(_parent),
@@ -26,13 +47,38 @@ QGLViewerWidget::QGLViewerWidget(QWidget* _parent)
 	copymodelviewmatrix(16, 0.0),
 	lastpoint2(0, 0),
 	lastpoint3(0),
-	lastpointok(false)
+	lastpointok(false),
+	interacting(false),
+	idletimer(new QTimer(this)),
+	pendingpoint(0, 0),
+	haspendingpoint(false),
+	pendingzoom(0.0),
+	framerequested(false),
+	frametimer(new QTimer(this)),
+	qualityframetime(1000.0 / 30.0),
+	qualitylevel(0),
+	qualityfastframes(0),
+	grabbing(false),
+	qualityfailed(false),
+	qualitysamples(0),
+	framequery(0),
+	framequeriesfailed(false),
+	framequerylevel(-1),
+	framequerytime(-1.0)
 {
 	Init();
 }
 
 QGLViewerWidget::~QGLViewerWidget(void)
 {
+	if (context())
+	{
+		disconnect(context(), nullptr, this, nullptr);
+		makeCurrent();
+		ReleaseQualityBuffers();
+		framequeries.clear();
+		doneCurrent();
+	}
 }
 
 void QGLViewerWidget::Init(void)
@@ -44,6 +90,20 @@ void QGLViewerWidget::Init(void)
 	//setCursor(PointingHandCursor);
 
 	SetProjectionMode(projectionmode);
+
+	idletimer->setSingleShot(true);
+	connect(idletimer, &QTimer::timeout, this, [this]()
+	{
+		if (mousemode != Qt::NoButton) return;
+		interacting = false;
+		RequestFrame();
+	});
+	frametimer->setSingleShot(true);
+	connect(frametimer, &QTimer::timeout, this, [this]()
+	{
+		update();
+	});
+	frameclock.start();
 }
 
 QSize QGLViewerWidget::minimumSizeHint(void) const
@@ -76,9 +136,7 @@ const double* QGLViewerWidget::GetModelviewMatrix(void) const
 
 void QGLViewerWidget::ResetModelviewMatrix(void)
 {
-	makeCurrent();
-	glLoadIdentity();
-	glGetDoublev(GL_MODELVIEW_MATRIX, &modelviewmatrix[0]);
+	CameraMath::Identity(&modelviewmatrix[0]);
 }
 
 void QGLViewerWidget::CopyModelViewMatrix(void)
@@ -98,8 +156,9 @@ const double* QGLViewerWidget::GetProjectionMatrix(void) const
 
 void QGLViewerWidget::SetDrawMode(const DrawMode &dm)
 {
+	if (dm == drawmode) return;
 	drawmode = dm;
-	update();
+	RequestFrame();
 }
 
 const QGLViewerWidget::DrawMode& QGLViewerWidget::GetDrawMode(void) const
@@ -107,6 +166,34 @@ const QGLViewerWidget::DrawMode& QGLViewerWidget::GetDrawMode(void) const
 	return drawmode;
 }
 
+void QGLViewerWidget::RequestFrame(void)
+{
+	if (framerequested) return;
+	framerequested = true;
+	const qint64 wait = isActiveWindow() ? 0 : backgroundinterval - frameclock.elapsed();
+	if (wait > 0)
+	{
+		frametimer->start(static_cast<int>(wait));
+	}
+	else
+	{
+		// Qt paints once for any number of updates before the next frame
+		update();
+	}
+}
+
+void QGLViewerWidget::SetQualityFrameTime(const double & milliseconds)
+{
+	qualityframetime = milliseconds;
+	qualitylevel = 0;
+	qualityfastframes = 0;
+}
+
+int QGLViewerWidget::QualityLevel(void) const
+{
+	return qualitylevel;
+}
+
 void QGLViewerWidget::SetProjectionMode(const ProjectionMode &pm)
 {
 	projectionmode = pm;
@@ -216,24 +303,240 @@ void QGLViewerWidget::initializeGL(void)
 	//glGetDoublev(GL_MODELVIEW_MATRIX, modelview_matrix_);
 
 	//for initialize all the viewports
-	glGetDoublev(GL_MODELVIEW_MATRIX, &modelviewmatrix[0]);
+	CameraMath::Identity(&modelviewmatrix[0]);
 	CopyModelViewMatrix();
 
 	SetScenePosition(OpenMesh::Vec3d(0.0, 0.0, 0.0), 1.0);
 	//LoadTexture();
+
+	// the context is recreated when the widget moves to another window
+	connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, [this]()
+	{
+		makeCurrent();
+		ReleaseQualityBuffers();
+		framequeries.clear();
+		doneCurrent();
+	});
 }
 
 void QGLViewerWidget::resizeGL(int _w, int _h)
 {
 	glViewport(0, 0, _w, _h);
 	UpdateProjectionMatrix();
-	update();
 }
 
 void QGLViewerWidget::paintGL(void)
 {
+	// a frame Qt paints on its own, after an expose or resize, counts too
+	framerequested = false;
+	frametimer->stop();
+	const qint64 interval = frameclock.restart();
+	ApplyInput();
+	const bool adapt = IsInteracting() && qualityframetime > 0.0;
+	const int level = adapt ? qualitylevel : 0;
+	const RenderQuality & quality = qualitylevels[level];
+	// at full size without samples the widget's framebuffer is drawn to
+	//   directly, multisampling off
+	const bool direct = quality.scale == 1.0 && quality.samples <= 0;
+	const bool offscreen = !direct && BindQualityBuffer(quality);
+	const bool reduced = level > 0 && (direct || offscreen);
+	QElapsedTimer timer;
+	bool queried = false;
+	if (adapt)
+	{
+		timer.start();
+		queried = BeginFrameQuery(level);
+	}
+	else
+	{
+		// times of earlier moving frames say nothing about the next ones
+		for (FrameQuery & q : framequeries) q.pending = false;
+	}
+	if (reduced)
+	{
+		glPushAttrib(GL_ENABLE_BIT | GL_HINT_BIT | GL_VIEWPORT_BIT);
+		if (offscreen) glViewport(0, 0, qualitybuffer->width(), qualitybuffer->height());
+		if (direct || qualitysamples == 0) glDisable(GL_MULTISAMPLE);
+		if (!quality.smooth)
+		{
+			glDisable(GL_LINE_SMOOTH);
+			glDisable(GL_POINT_SMOOTH);
+			glHint(GL_LINE_SMOOTH_HINT, GL_FASTEST);
+			glHint(GL_POINT_SMOOTH_HINT, GL_FASTEST);
+		}
+	}
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	DrawScene();
+	if (reduced) glPopAttrib();
+	if (offscreen) ResolveQualityBuffer();
+	if (adapt)
+	{
+		// the time to issue the frame, and the GPU time of an earlier one
+		//   at this level; without timer queries the time since the last
+		//   moving frame at this level stands in, the swap waits for the GPU
+		double frametime = timer.nsecsElapsed() * 1e-6;
+		if (queried)
+		{
+			frametime = std::max(frametime, EndFrameQuery(level));
+		}
+		else if (framequerylevel == level && interval < interactionidle)
+		{
+			frametime = std::max(frametime, static_cast<double>(interval));
+		}
+		framequerylevel = level;
+		AdaptQuality(frametime);
+	}
+	else
+	{
+		framequerylevel = -1;
+	}
+}
+
+bool QGLViewerWidget::BeginFrameQuery(int level)
+{
+	if (framequeries.empty() && !framequeriesfailed)
+	{
+		framequeries.resize(nframequeries);
+		for (FrameQuery & q : framequeries)
+		{
+			q.query.reset(new QOpenGLTimerQuery);
+			q.level = -1;
+			q.pending = false;
+			if (!q.query->create()) framequeriesfailed = true;
+		}
+		if (framequeriesfailed)
+		{
+			std::cerr << "  Warning! Timer queries are not supported, the quality follows the time between frames." << std::endl;
+			framequeries.clear();
+		}
+	}
+	if (framequeries.empty()) return false;
+	// the slot is reused after nframequeries frames; a result that is not
+	//   there by then is dropped rather than waited for
+	FrameQuery & q = framequeries[framequery];
+	framequerytime = -1.0;
+	if (q.pending && q.level == level && q.query->isResultAvailable())
+	{
+		framequerytime = q.query->waitForResult() * 1e-6;
+	}
+	q.pending = false;
+	q.query->begin();
+	return true;
+}
+
+double QGLViewerWidget::EndFrameQuery(int level)
+{
+	FrameQuery & q = framequeries[framequery];
+	q.query->end();
+	q.level = level;
+	q.pending = true;
+	framequery = (framequery + 1) % nframequeries;
+	return framequerytime;
+}
+
+bool QGLViewerWidget::BindQualityBuffer(const RenderQuality & quality)
+{
+	if (qualityfailed) return false;
+	if (!QOpenGLFramebufferObject::hasOpenGLFramebufferObjects())
+	{
+		std::cerr << "  Warning! Framebuffer objects are not supported, the view is drawn at full quality while it moves." << std::endl;
+		qualityfailed = true;
+		return false;
+	}
+	const double ratio = devicePixelRatioF() * quality.scale;
+	const QSize size(std::max(1, static_cast<int>(width() * ratio + 0.5)), std::max(1, static_cast<int>(height() * ratio + 0.5)));
+	// a multisampled buffer is copied to a single sampled one to be drawn
+	const int samples = QOpenGLFramebufferObject::hasOpenGLFramebufferBlit() ? quality.samples : 0;
+	if (!qualitybuffer || qualitybuffer->size() != size || qualitysamples != samples)
+	{
+		QOpenGLFramebufferObjectFormat format;
+		format.setAttachment(QOpenGLFramebufferObject::Depth);
+		format.setSamples(samples);
+		qualitybuffer.reset(new QOpenGLFramebufferObject(size, format));
+		resolvebuffer.reset(samples > 0 ? new QOpenGLFramebufferObject(size) : nullptr);
+		qualitysamples = samples;
+		if (!qualitybuffer->isValid() || (resolvebuffer && !resolvebuffer->isValid()))
+		{
+			std::cerr << "  Warning! Failed to create the offscreen buffers, the view is drawn at full quality while it moves." << std::endl;
+			ReleaseQualityBuffers();
+			qualityfailed = true;
+			return false;
+		}
+	}
+	return qualitybuffer->bind();
+}
+
+void QGLViewerWidget::ResolveQualityBuffer(void)
+{
+	QOpenGLFramebufferObject* source = qualitybuffer.get();
+	if (resolvebuffer)
+	{
+		QOpenGLFramebufferObject::blitFramebuffer(resolvebuffer.get(), qualitybuffer.get());
+		source = resolvebuffer.get();
+	}
+	context()->functions()->glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_BLEND);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, source->texture());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 0.0f);
+	glVertex2f(-1.0f, -1.0f);
+	glTexCoord2f(1.0f, 0.0f);
+	glVertex2f(1.0f, -1.0f);
+	glTexCoord2f(1.0f, 1.0f);
+	glVertex2f(1.0f, 1.0f);
+	glTexCoord2f(0.0f, 1.0f);
+	glVertex2f(-1.0f, 1.0f);
+	glEnd();
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+}
+
+void QGLViewerWidget::ReleaseQualityBuffers(void)
+{
+	qualitybuffer.reset();
+	resolvebuffer.reset();
+	qualitysamples = 0;
+}
+
+void QGLViewerWidget::AdaptQuality(const double & frametime)
+{
+	if (frametime > qualityframetime)
+	{
+		qualityfastframes = 0;
+		if (qualitylevel + 1 < nqualitylevels) ++qualitylevel;
+	}
+	else if (qualitylevel > 0 && frametime < 0.5 * qualityframetime)
+	{
+		// a level just within the time would otherwise take turns with the
+		//   one above it
+		if (++qualityfastframes >= qualityraiseframes)
+		{
+			--qualitylevel;
+			qualityfastframes = 0;
+		}
+	}
+	else
+	{
+		qualityfastframes = 0;
+	}
 }
 
 void QGLViewerWidget::DrawScene(void)
@@ -274,41 +577,34 @@ void QGLViewerWidget::DrawScene(void)
 void QGLViewerWidget::mousePressEvent(QMouseEvent* _event)
 {
 	//assert(mousemode < N_MOUSE_MODES);
+	ApplyInput();
 	lastpoint2 = _event->pos();
 	lastpointok = MapToSphere(lastpoint2, lastpoint3);
 	mousemode = _event->button();
+	interacting = true;
+	idletimer->stop();
 }
 
 void QGLViewerWidget::mouseMoveEvent(QMouseEvent* _event)
 {
-	QPoint newPoint2D = _event->pos();
-	if (lastpointok)
+	// the moves until the next frame are applied together by ApplyInput
+	pendingpoint = _event->pos();
+	haspendingpoint = true;
+	if (mousemode == Qt::LeftButton || mousemode == Qt::RightButton)
 	{
-		switch (mousemode)
-		{
-		case Qt::LeftButton:
-			Rotation(newPoint2D);
-			break;
-		case Qt::RightButton:
-			Translation(newPoint2D);
-			break;
-		default:
-			break;
-		}
-	} // end of if
-
-	// remember this point
-	lastpoint2 = newPoint2D;
-	lastpointok = MapToSphere(lastpoint2, lastpoint3);
-	// trigger redraw
-	update();
+		RequestFrame();
+	}
 }
 
 void QGLViewerWidget::mouseReleaseEvent(QMouseEvent*  _event)
 {
 	//assert(mousemode < N_MOUSE_MODES);
+	bool moved = haspendingpoint;
+	ApplyInput();
 	mousemode = Qt::NoButton;
 	lastpointok = false;
+	idletimer->start(interactionidle);
+	if (moved) RequestFrame();
 }
 
 void QGLViewerWidget::wheelEvent(QWheelEvent* _event)
@@ -317,8 +613,39 @@ void QGLViewerWidget::wheelEvent(QWheelEvent* _event)
 	//double d = -_event->delta() / 120.0 * 0.05 * radius;
 
 	double d = - _event->angleDelta().x() / 120.0 * 0.05 * radius;
-	Translate(OpenMesh::Vec3d(0.0, 0.0, d));
-	update();
+	pendingzoom += d;
+	interacting = true;
+	idletimer->start(interactionidle);
+	RequestFrame();
+}
+
+void QGLViewerWidget::ApplyInput(void)
+{
+	if (haspendingpoint)
+	{
+		haspendingpoint = false;
+		if (lastpointok)
+		{
+			switch (mousemode)
+			{
+			case Qt::LeftButton:
+				Rotation(pendingpoint);
+				break;
+			case Qt::RightButton:
+				Translation(pendingpoint);
+				break;
+			default:
+				break;
+			}
+		}
+		lastpoint2 = pendingpoint;
+		lastpointok = MapToSphere(lastpoint2, lastpoint3);
+	}
+	if (pendingzoom != 0.0)
+	{
+		Translate(OpenMesh::Vec3d(0.0, 0.0, pendingzoom));
+		pendingzoom = 0.0;
+	}
 }
 
 void QGLViewerWidget::keyPressEvent(QKeyEvent* _event)
@@ -337,12 +664,22 @@ void QGLViewerWidget::keyReleaseEvent(QKeyEvent* _event)
 	_event->ignore();
 }
 
+bool QGLViewerWidget::IsInteracting(void) const
+{
+	return interacting && !grabbing;
+}
+
+QImage QGLViewerWidget::GrabFullQuality(void)
+{
+	grabbing = true;
+	QImage image = grabFramebuffer();
+	grabbing = false;
+	return image;
+}
+
 void QGLViewerWidget::Translation(const QPoint & p)
 {
-	double z = -(modelviewmatrix[2] * center[0] +
-		modelviewmatrix[6] * center[1] +
-		modelviewmatrix[10] * center[2] +
-		modelviewmatrix[14]) /
+	double z = -CameraMath::Transform(&modelviewmatrix[0], center)[2] /
 		(modelviewmatrix[3] * center[0] +
 			modelviewmatrix[7] * center[1] +
 			modelviewmatrix[11] * center[2] +
@@ -366,11 +703,7 @@ void QGLViewerWidget::Translate(const OpenMesh::Vec3d & _trans)
 {
 	// Translate the object by _trans
 	// Update modelview_matrix_
-	makeCurrent();
-	glLoadIdentity();
-	glTranslated(_trans[0], _trans[1], _trans[2]);
-	glMultMatrixd(&modelviewmatrix[0]);
-	glGetDoublev(GL_MODELVIEW_MATRIX, &modelviewmatrix[0]);
+	CameraMath::PreTranslate(_trans, &modelviewmatrix[0]);
 }
 
 void QGLViewerWidget::Rotation(const QPoint & p)
@@ -403,27 +736,8 @@ void QGLViewerWidget::Rotate(const OpenMesh::Vec3d& _axis, const double & _angle
 {
 	// Rotate around center center_, axis _axis, by angle _angle
 	// Update modelview_matrix_
-
-	OpenMesh::Vec3d t(modelviewmatrix[0] * center[0] +
-		modelviewmatrix[4] * center[1] +
-		modelviewmatrix[8] * center[2] +
-		modelviewmatrix[12],
-		modelviewmatrix[1] * center[0] +
-		modelviewmatrix[5] * center[1] +
-		modelviewmatrix[9] * center[2] +
-		modelviewmatrix[13],
-		modelviewmatrix[2] * center[0] +
-		modelviewmatrix[6] * center[1] +
-		modelviewmatrix[10] * center[2] +
-		modelviewmatrix[14]);
-
-	makeCurrent();
-	glLoadIdentity();
-	glTranslatef(t[0], t[1], t[2]);
-	glRotated(_angle, _axis[0], _axis[1], _axis[2]);
-	glTranslatef(-t[0], -t[1], -t[2]);
-	glMultMatrixd(&modelviewmatrix[0]);
-	glGetDoublev(GL_MODELVIEW_MATRIX, &modelviewmatrix[0]);
+	OpenMesh::Vec3d t = CameraMath::Transform(&modelviewmatrix[0], center);
+	CameraMath::PreRotate(CameraMath::Quaternion::FromAxisAngle(_axis, _angle), t, &modelviewmatrix[0]);
 }
 
 bool QGLViewerWidget::MapToSphere(const QPoint& _v2D, OpenMesh::Vec3d& _v3D)
@@ -453,24 +767,21 @@ bool QGLViewerWidget::MapToSphere(const QPoint& _v2D, OpenMesh::Vec3d& _v3D)
 
 void QGLViewerWidget::UpdateProjectionMatrix(void)
 {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-
+	// loaded into OpenGL by DrawScene
 	if (PERSPECTIVE == projectionmode)
 	{
-		glFrustum(-0.01 * radius * (sqrt(2.0) - 1) * width() / height(),
+		CameraMath::Frustum(-0.01 * radius * (sqrt(2.0) - 1) * width() / height(),
 			0.01 * radius * (sqrt(2.0) - 1) * width() / height(),
 			-0.01 * radius * (sqrt(2.0) - 1),
 			0.01 * radius * (sqrt(2.0) - 1),
 			0.01 * radius,
-			100.0 * radius);
+			100.0 * radius,
+			&projectionmatrix[0]);
 	}
 	else if (ORTHOGRAPHIC == projectionmode) //not work for 
 	{
-		glOrtho(windowleft, windowright, windowbottom, windowtop, -1, 1);
+		CameraMath::Ortho(windowleft, windowright, windowbottom, windowtop, -1, 1, &projectionmatrix[0]);
 	}
-	glGetDoublev(GL_PROJECTION_MATRIX, &projectionmatrix[0]);
-	glMatrixMode(GL_MODELVIEW);
 }
 
 void QGLViewerWidget::SetScenePosition(const OpenMesh::Vec3d& _center, const double & _radius)
@@ -484,23 +795,7 @@ void QGLViewerWidget::SetScenePosition(const OpenMesh::Vec3d& _center, const dou
 
 void QGLViewerWidget::ViewAll(void)
 {
-	OpenMesh::Vec3d _trans = OpenMesh::Vec3d(-(modelviewmatrix[0] * center[0] +
-		modelviewmatrix[4] * center[1] +
-		modelviewmatrix[8] * center[2] +
-		modelviewmatrix[12]),
-		-(modelviewmatrix[1] * center[0] +
-		modelviewmatrix[5] * center[1] +
-		modelviewmatrix[9] * center[2] +
-		modelviewmatrix[13]),
-		-(modelviewmatrix[2] * center[0] +
-		modelviewmatrix[6] * center[1] +
-		modelviewmatrix[10] * center[2] +
-		modelviewmatrix[14] +
-		2.0*radius));
-
-	makeCurrent();
-	glLoadIdentity();
-	glTranslated(_trans[0], _trans[1], _trans[2]);
-	glMultMatrixd(&modelviewmatrix[0]);
-	glGetDoublev(GL_MODELVIEW_MATRIX, &modelviewmatrix[0]);
+	// move the center to (0, 0, -2 radius) in eye space
+	OpenMesh::Vec3d _trans = -CameraMath::Transform(&modelviewmatrix[0], center) - OpenMesh::Vec3d(0.0, 0.0, 2.0*radius);
+	CameraMath::PreTranslate(_trans, &modelviewmatrix[0]);
 }
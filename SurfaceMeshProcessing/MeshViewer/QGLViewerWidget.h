@@ -1,7 +1,12 @@
 #pragma once
 #include <OpenMesh/Core/Geometry/VectorT.hh>
 #include <QOpenGLWidget>
+#include <QElapsedTimer>
+#include <memory>
 class QOpenGLTexture;
+class QOpenGLFramebufferObject;
+class QOpenGLTimerQuery;
+class QTimer;
 
 class QGLViewerWidget : public QOpenGLWidget
 {
@@ -30,6 +35,21 @@ public:
 	void SetDrawMode(const DrawMode &dm);
 	const DrawMode& GetDrawMode(void) const;
 
+	// Asks for a frame instead of painting at once: requests before the
+	//   frame is drawn share it, mouse moves and wheel steps are added up and
+	//   applied once when it is drawn, and while the window is in the
+	//   background frames are at least backgroundinterval ms apart.
+	void RequestFrame(void);
+	// Sets the time a frame may take while the view moves. Slower frames
+	//   step the quality down, to fewer samples and then to fewer pixels
+	//   scaled up to the widget, and a run of fast ones steps it back up.
+	//   Still frames and grabs are always drawn at full quality; 0 keeps full
+	//   quality while moving too.
+	void SetQualityFrameTime(const double & milliseconds);
+	// the index into qualitylevels used while the view moves, 0 is full
+	//   quality
+	int QualityLevel(void) const;
+
 protected:
 	enum MaterialType { MaterialDefault, MaterialGold, MaterialSilver, MaterialEmerald, MaterialTin };
 	void SetMaterial(const MaterialType & mattype = MaterialGold) const;
@@ -44,6 +64,14 @@ protected:
 	virtual void wheelEvent(QWheelEvent*) override;
 	virtual void keyPressEvent(QKeyEvent*) override;
 	virtual void keyReleaseEvent(QKeyEvent*) override;
+	// true while a mouse button is held, and until no button was released
+	//   and no wheel event came for interactionidle ms; the view is drawn
+	//   again when it ends. False during GrabFullQuality.
+	bool IsInteracting(void) const;
+	// grabFramebuffer drawn as a still frame, even while the view moves
+	QImage GrabFullQuality(void);
+	// applies the mouse moves and wheel steps since the last frame
+	void ApplyInput(void);
 private:
 	void Translation(const QPoint & p);
 	void Translate(const OpenMesh::Vec3d & trans);
@@ -51,6 +79,27 @@ private:
 	void Rotate(const OpenMesh::Vec3d & axis, const double & angle);
 	bool MapToSphere(const QPoint & point, OpenMesh::Vec3d & result);
 	void UpdateProjectionMatrix(void);
+	struct RenderQuality
+	{
+		// of the width and height of the widget
+		double scale;
+		// -1 keeps the samples of the widget's framebuffer; at a scale of 1,
+		//   0 draws to it with multisampling off, other counts draw offscreen
+		int samples;
+		bool smooth;
+	};
+	// binds an offscreen buffer for the quality, false if there is none
+	bool BindQualityBuffer(const RenderQuality & quality);
+	// draws the offscreen buffer to the widget, scaled to fill it
+	void ResolveQualityBuffer(void);
+	void ReleaseQualityBuffers(void);
+	// times the GPU work of a moving frame drawn at level, false without
+	//   timer queries
+	bool BeginFrameQuery(int level);
+	// the GPU time in ms of an earlier frame drawn at level, read when it is
+	//   available so no frame waits for it; -1 when there is none
+	double EndFrameQuery(int level);
+	void AdaptQuality(const double & frametime);
 public:
 	void SetScenePosition(const OpenMesh::Vec3d & c, const double & r);
 	void ViewAll(void);
@@ -71,5 +120,49 @@ protected:
 	OpenMesh::Vec3d lastpoint3;
 	bool lastpointok;
 private:
+	bool interacting;
+	QTimer* idletimer;
+	// the input ApplyInput has not applied yet: the latest mouse position,
+	//   and the sum of the wheel steps as a distance along the view axis
+	QPoint pendingpoint;
+	bool haspendingpoint;
+	double pendingzoom;
+	// a frame was requested and is not drawn yet; a background frame waits
+	//   for frametimer, frameclock runs since the last frame
+	bool framerequested;
+	QTimer* frametimer;
+	QElapsedTimer frameclock;
 	static const double trackballradius;
+	static const int interactionidle;
+	static const int backgroundinterval;
+	double qualityframetime;
+	int qualitylevel;
+	int qualityfastframes;
+	bool grabbing;
+	// the buffers could not be made, moving frames are drawn at full quality
+	bool qualityfailed;
+	// the offscreen target, and the single sampled copy of a multisampled one
+	//   to draw from; qualitysamples were asked for qualitybuffer
+	std::unique_ptr<QOpenGLFramebufferObject> qualitybuffer;
+	std::unique_ptr<QOpenGLFramebufferObject> resolvebuffer;
+	int qualitysamples;
+	// a ring of timer queries, a few frames deep; framequerylevel is the
+	//   level of the last moving frame, -1 after a still one, and
+	//   framequerytime the time BeginFrameQuery read
+	struct FrameQuery
+	{
+		std::unique_ptr<QOpenGLTimerQuery> query;
+		int level;
+		bool pending;
+	};
+	std::vector<FrameQuery> framequeries;
+	int framequery;
+	bool framequeriesfailed;
+	int framequerylevel;
+	double framequerytime;
+	static const int nframequeries;
+	static const RenderQuality qualitylevels[];
+	static const int nqualitylevels;
+	// fast frames in a row before the quality steps back up
+	static const int qualityraiseframes;
 };
@@ -0,0 +1,222 @@
+#include <charconv>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "OBJParser.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	inline const char* SkipBlank(const char* p, const char* end)
+	{
+		while (p < end && IsBlank(*p)) ++p;
+		return p;
+	}
+
+	inline const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsBlank(*p)) ++p;
+		return p;
+	}
+
+	// from_chars does not accept the leading '+' that iostreams do
+	template <typename T>
+	inline bool ParseNumber(const char* p, const char* end, T & value, const char** next = nullptr)
+	{
+		if (p < end && *p == '+') ++p;
+		auto result = std::from_chars(p, end, value);
+		if (next) *next = result.ptr;
+		return result.ec == std::errc();
+	}
+
+	// the indices and offsets are ints, as are the handles they turn into
+	bool TooLarge(long long npositions, size_t nindices)
+	{
+		if (npositions < INT_MAX && nindices < static_cast<size_t>(INT_MAX)) return false;
+		std::cerr << "  Warning! The OBJ file has more than " << INT_MAX << " vertices or face corners.\n";
+		return true;
+	}
+}
+
+OBJData::OBJData(void)
+	: faceoffsets(1, 0),
+	npositions(0)
+{
+}
+
+void OBJData::Clear(void)
+{
+	points.clear();
+	faceindices.clear();
+	faceoffsets.assign(1, 0);
+	npositions = 0;
+	relativeindices.clear();
+}
+
+bool OBJParser::Parse(const char* begin, const char* end, OBJData & data, LoadProgress* progress)
+{
+	const size_t reportsize = size_t(1) << 22;
+	const char* reported = begin;
+	const char* p = begin;
+	while (p < end)
+	{
+		if (progress && static_cast<size_t>(p - reported) >= reportsize)
+		{
+			progress->bytesparsed += p - reported;
+			reported = p;
+			if (progress->cancelled) return false;
+		}
+
+		const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (eol == nullptr) eol = end;
+		const char* q = SkipBlank(p, eol);
+		p = eol + 1;
+
+		// empty line or comment
+		if (q == eol || *q == '#') continue;
+
+		const char* keyend = SkipToken(q, eol);
+		if (keyend - q != 1) continue;
+		if (TooLarge(data.npositions, data.faceindices.size())) return false;
+		if (*q == 'v')
+		{
+			ParseVertex(keyend, eol, data);
+		}
+		else if (*q == 'f')
+		{
+			ParseFace(keyend, eol, data);
+		}
+	}
+	if (progress) progress->bytesparsed += end - reported;
+	return true;
+}
+
+void OBJParser::ParseVertex(const char* p, const char* end, OBJData & data)
+{
+	++data.npositions;
+	Mesh::Point point;
+	for (int i = 0; i < 3; ++i)
+	{
+		p = SkipBlank(p, end);
+		// from_chars takes "inf" and "nan", which no mesh tool is ready for
+		if (!ParseNumber(p, end, point[i], &p) || !std::isfinite(point[i])) return;
+	}
+	data.points.push_back(point);
+}
+
+void OBJParser::ParseFace(const char* p, const char* end, OBJData & data)
+{
+	while (true)
+	{
+		p = SkipBlank(p, end);
+		if (p == end) break;
+		const char* tokenend = SkipToken(p, end);
+
+		// read one block from the line ( vertex/texCoord/normal ), only the
+		//   vertex component is used
+		const char* slash = static_cast<const char*>(std::memchr(p, '/', tokenend - p));
+		const char* valueend = slash ? slash : tokenend;
+		int value;
+		bool ok = valueend != p && ParseNumber(p, valueend, value);
+		p = tokenend;
+		if (!ok) continue;
+
+		if (value < 0)
+		{
+			// -1 is the last vertex in the list
+			value = data.npositions + value + 1;
+			data.relativeindices.push_back(data.faceindices.size());
+		}
+		// obj counts from 1
+		data.faceindices.push_back(value - 1);
+	}
+	data.faceoffsets.push_back(static_cast<int>(data.faceindices.size()));
+}
+
+bool OBJParser::ParseParallel(const char* begin, const char* end, OBJData & data, LoadProgress* progress)
+{
+	// chunks of at least 4 MB, a few per thread to even out the load
+	const size_t minchunk = size_t(4) << 20;
+	size_t size = end - begin;
+	size_t nchunks = std::min(size / minchunk, size_t(4) * ThreadPool::Global().Size());
+	if (nchunks <= 1)
+	{
+		return Parse(begin, end, data, progress);
+	}
+
+	std::vector<const char*> bounds(nchunks + 1, end);
+	bounds[0] = begin;
+	for (size_t i = 1; i < nchunks; ++i)
+	{
+		const char* p = std::max(begin + size / nchunks * i, bounds[i - 1]);
+		const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		bounds[i] = eol ? eol + 1 : end;
+	}
+
+	std::vector<OBJData> chunks(nchunks);
+	std::atomic<bool> parse_OK(true);
+	ThreadPool::Global().ParallelFor(static_cast<int>(nchunks), [&](int i)
+	{
+		if (!parse_OK || !Parse(bounds[i], bounds[i + 1], chunks[i], progress)) parse_OK = false;
+	});
+	if (!parse_OK) return false;
+	return Merge(chunks, data);
+}
+
+bool OBJParser::Merge(std::vector<OBJData> & chunks, OBJData & data)
+{
+	// prefix sums over the chunks give where each one lands in the result,
+	//   and how far its negative indices have to be shifted
+	size_t nchunks = chunks.size();
+	std::vector<size_t> pointoffset(nchunks + 1, 0), indexoffset(nchunks + 1, 0), faceoffset(nchunks + 1, 0);
+	std::vector<int> positionoffset(nchunks + 1, data.npositions);
+	for (size_t i = 0; i < nchunks; ++i)
+	{
+		pointoffset[i + 1] = pointoffset[i] + chunks[i].points.size();
+		indexoffset[i + 1] = indexoffset[i] + chunks[i].faceindices.size();
+		faceoffset[i + 1] = faceoffset[i] + chunks[i].faceoffsets.size() - 1;
+		if (TooLarge(static_cast<long long>(positionoffset[i]) + chunks[i].npositions,
+			data.faceindices.size() + indexoffset[i + 1]))
+		{
+			return false;
+		}
+		positionoffset[i + 1] = positionoffset[i] + chunks[i].npositions;
+	}
+
+	size_t pointbase = data.points.size();
+	size_t indexbase = data.faceindices.size();
+	size_t facebase = data.faceoffsets.size() - 1;
+	data.points.resize(pointbase + pointoffset[nchunks]);
+	data.faceindices.resize(indexbase + indexoffset[nchunks]);
+	data.faceoffsets.resize(facebase + faceoffset[nchunks] + 1);
+	data.npositions = positionoffset[nchunks];
+
+	ThreadPool::Global().ParallelFor(static_cast<int>(nchunks), [&](int i)
+	{
+		OBJData & chunk = chunks[i];
+		std::copy(chunk.points.begin(), chunk.points.end(), data.points.begin() + pointbase + pointoffset[i]);
+		int shift = positionoffset[i];
+		for (auto j : chunk.relativeindices)
+		{
+			chunk.faceindices[j] += shift;
+		}
+		std::copy(chunk.faceindices.begin(), chunk.faceindices.end(), data.faceindices.begin() + indexbase + indexoffset[i]);
+		int base = static_cast<int>(indexbase + indexoffset[i]);
+		for (size_t j = 1; j < chunk.faceoffsets.size(); ++j)
+		{
+			data.faceoffsets[facebase + faceoffset[i] + j] = base + chunk.faceoffsets[j];
+		}
+		std::vector<Mesh::Point>().swap(chunk.points);
+		std::vector<int>().swap(chunk.faceindices);
+	});
+	// the merged indices are absolute now
+	data.relativeindices.clear();
+	return true;
+}
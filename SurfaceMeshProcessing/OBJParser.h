@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include "MeshDefinition.h"
+
+// Positions and polygons gathered from the "v" and "f" records of an OBJ file.
+//   Face i uses the 0-based vertex indices faceindices[faceoffsets[i]] up to
+//   faceindices[faceoffsets[i + 1]]; they are not checked against the number of
+//   points.
+struct OBJData
+{
+	OBJData(void);
+	void Clear(void);
+	std::vector<Mesh::Point> points;
+	std::vector<int> faceindices;
+	std::vector<int> faceoffsets;
+	// number of "v" records seen, including malformed ones, which is what
+	//   negative indices are relative to
+	int npositions;
+	// entries of faceindices that came from negative indices; they are only
+	//   relative to the start of the parsed buffer until chunks are merged
+	std::vector<size_t> relativeindices;
+};
+
+// Hand-written tokenizer for OBJ text that works on a whole buffer at once,
+//   typically a memory-mapped file. It follows MeshTools::ReadOBJ: only
+//   positions and face position indices are kept, "v/vt/vn" blocks use their
+//   first component, and negative indices count back from the last "v" record
+//   above the face. A "v" record with a coordinate that is not finite counts
+//   as malformed.
+class OBJParser
+{
+public:
+	// Both return false if progress->cancelled was set while parsing, or if
+	//   the file has INT_MAX or more "v" records or face corners, which the int
+	//   indices cannot hold.
+	static bool Parse(const char* begin, const char* end, OBJData & data, LoadProgress* progress = nullptr);
+	// Splits the buffer at line boundaries, parses the chunks on the global
+	//   thread pool and merges them in file order.
+	static bool ParseParallel(const char* begin, const char* end, OBJData & data, LoadProgress* progress = nullptr);
+private:
+	static bool Merge(std::vector<OBJData> & chunks, OBJData & data);
+	static void ParseVertex(const char* p, const char* end, OBJData & data);
+	static void ParseFace(const char* p, const char* end, OBJData & data);
+};
@@ -0,0 +1,120 @@
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include "OBJWriter.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	const int BlockSize = 1 << 16;
+
+	inline char* FormatScalar(char* p, char* end, Mesh::Point::value_type value, int precision)
+	{
+		if (precision > 0)
+		{
+			return std::to_chars(p, end, value, std::chars_format::general, precision).ptr;
+		}
+		return std::to_chars(p, end, value).ptr;
+	}
+}
+
+bool OBJWriter::Write(const Mesh & mesh, const std::string & filename, const int & precision, const bool & parallel)
+{
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs.is_open())
+	{
+		std::cerr << "Error: cannot open file " << filename << std::endl;
+		return false;
+	}
+	int digits = precision >= std::numeric_limits<Mesh::Point::value_type>::max_digits10 ? 0 : precision;
+	int nvertexblocks = static_cast<int>((mesh.n_vertices() + BlockSize - 1) / BlockSize);
+	int nfaceblocks = static_cast<int>((mesh.n_faces() + BlockSize - 1) / BlockSize);
+	int nblocks = nvertexblocks + nfaceblocks;
+
+	// blocks are formatted a batch at a time so memory stays bounded
+	int batch = parallel ? 2 * ThreadPool::Global().Size() : 1;
+	std::vector<std::string> buffers(batch);
+	for (int first = 0; first < nblocks; first += batch)
+	{
+		int count = std::min(batch, nblocks - first);
+		auto format = [&](int i)
+		{
+			int block = first + i;
+			buffers[i].clear();
+			if (block < nvertexblocks)
+			{
+				int begin = block * BlockSize;
+				FormatVertices(mesh, begin, std::min(static_cast<int>(mesh.n_vertices()), begin + BlockSize), digits, buffers[i]);
+			}
+			else
+			{
+				int begin = (block - nvertexblocks) * BlockSize;
+				FormatFaces(mesh, begin, std::min(static_cast<int>(mesh.n_faces()), begin + BlockSize), buffers[i]);
+			}
+		};
+		if (parallel)
+		{
+			ThreadPool::Global().ParallelFor(count, format);
+		}
+		else
+		{
+			format(0);
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			ofs.write(buffers[i].data(), buffers[i].size());
+		}
+	}
+	ofs.close();
+	if (ofs.fail())
+	{
+		std::cerr << "Error: cannot write file " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void OBJWriter::FormatVertices(const Mesh & mesh, int begin, int end, int precision, std::string & buffer)
+{
+	// "v " + three numbers of at most 32 characters each + separators
+	const size_t maxline = 2 + 3 * 33;
+	buffer.resize(maxline * (end - begin));
+	char* p = &buffer[0];
+	char* last = p + buffer.size();
+	for (int i = begin; i < end; ++i)
+	{
+		Mesh::VertexHandle vh(i);
+		if (mesh.status(vh).deleted()) continue;
+		const auto & point = mesh.point(vh);
+		*p++ = 'v';
+		for (int k = 0; k < 3; ++k)
+		{
+			*p++ = ' ';
+			p = FormatScalar(p, last, point[k], precision);
+		}
+		*p++ = '\n';
+	}
+	buffer.resize(p - &buffer[0]);
+}
+
+void OBJWriter::FormatFaces(const Mesh & mesh, int begin, int end, std::string & buffer)
+{
+	buffer.clear();
+	char line[16];
+	for (int i = begin; i < end; ++i)
+	{
+		Mesh::FaceHandle fh(i);
+		if (mesh.status(fh).deleted()) continue;
+		buffer += 'f';
+		for (const auto & fvh : mesh.fv_range(fh))
+		{
+			line[0] = ' ';
+			char* p = std::to_chars(line + 1, line + sizeof(line), fvh.idx() + 1).ptr;
+			buffer.append(line, p);
+		}
+		buffer += '\n';
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include "MeshDefinition.h"
+
+// Writes "v" and "f" records like MeshTools::WriteOBJ, but formats them with
+//   std::to_chars into large blocks that are written out in one call each.
+//   With parallel, several blocks are formatted at once on the thread pool and
+//   written in order.
+//
+//   A precision of 0, or at least max_digits10, gives the shortest text that
+//   reads back to the same double; otherwise numbers are printed like
+//   std::ostream does with that precision.
+class OBJWriter
+{
+public:
+	static bool Write(const Mesh & mesh, const std::string & filename, const int & precision = 0, const bool & parallel = true);
+private:
+	static void FormatVertices(const Mesh & mesh, int begin, int end, int precision, std::string & buffer);
+	static void FormatFaces(const Mesh & mesh, int begin, int end, std::string & buffer);
+};
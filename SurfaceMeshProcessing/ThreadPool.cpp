@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	thread_local bool insidepool = false;
+}
+
+ThreadPool::ThreadPool(int nthreads)
+	: stopping(false)
+{
+	if (nthreads <= 0)
+	{
+		nthreads = static_cast<int>(std::thread::hardware_concurrency());
+		if (nthreads <= 0) nthreads = 1;
+	}
+	// the calling thread is one of the workers of a loop
+	for (int i = 1; i < nthreads; ++i)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobready.notify_all();
+	for (auto & t : workers)
+	{
+		t.join();
+	}
+}
+
+ThreadPool & ThreadPool::Global(void)
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+int ThreadPool::Size(void) const
+{
+	return static_cast<int>(workers.size()) + 1;
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)> & task)
+{
+	if (n <= 0) return;
+	if (n == 1 || workers.empty() || insidepool)
+	{
+		for (int i = 0; i < n; ++i) task(i);
+		return;
+	}
+	Job job;
+	job.task = &task;
+	job.size = n;
+	job.next = 0;
+	job.nrunning = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(&job);
+	}
+	jobready.notify_all();
+	insidepool = true;
+	while (RunTask(job));
+	insidepool = false;
+	std::unique_lock<std::mutex> lock(mutex);
+	jobdone.wait(lock, [&] { return job.nrunning == 0; });
+	jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+	if (job.error) std::rethrow_exception(job.error);
+}
+
+void ThreadPool::WorkerLoop(void)
+{
+	insidepool = true;
+	while (true)
+	{
+		Job* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobready.wait(lock, [&] { return stopping || (job = OpenJob()) != nullptr; });
+			if (stopping) return;
+			++job->nrunning;
+		}
+		RunTask(*job);
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--job->nrunning == 0) jobdone.notify_all();
+	}
+}
+
+ThreadPool::Job* ThreadPool::OpenJob(void) const
+{
+	// the loop with tasks left and the fewest threads on it
+	Job* open = nullptr;
+	for (Job* job : jobs)
+	{
+		if (job->next.load() >= job->size) continue;
+		if (!open || job->nrunning < open->nrunning) open = job;
+	}
+	return open;
+}
+
+bool ThreadPool::RunTask(Job & job)
+{
+	int i = job.next++;
+	if (i >= job.size) return false;
+	try
+	{
+		(*job.task)(i);
+	}
+	catch (...)
+	{
+		// the other threads stop at their next task
+		job.next = job.size;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!job.error) job.error = std::current_exception();
+		return false;
+	}
+	return true;
+}
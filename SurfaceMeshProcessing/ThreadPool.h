@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+// A fixed set of worker threads that run index-parallel loops. The calling
+//   thread takes part in its loop, and loops started by several threads at
+//   once share the workers: a worker takes its next task from the loop with
+//   the fewest threads on it, so a short loop from the GUI thread is not
+//   held up behind a long one from a loader. A loop started from inside a
+//   task runs serially on the thread that started it.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(int nthreads = 0);
+	~ThreadPool(void);
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+	static ThreadPool & Global(void);
+	int Size(void) const;
+	// Calls task(i) for every i in [0, n) and returns once all calls finished.
+	//   If a call throws, the calls not started yet are skipped, and the first
+	//   exception is rethrown once the running ones finished.
+	void ParallelFor(int n, const std::function<void(int)> & task);
+	// elements per block of ParallelBlocks; a constant, so that results kept
+	//   per block do not depend on the number of threads
+	static const int blocksize = 1 << 12;
+	// Calls task(b, begin, end) for the blocks [begin, end) of [0, n), b
+	//   counting from 0, in any order; with parallel off they run in order
+	//   on the calling thread.
+	template <typename Index, typename Task>
+	void ParallelBlocks(Index n, bool parallel, const Task & task);
+private:
+	// one running ParallelFor call; lives on the stack of its caller
+	struct Job
+	{
+		const std::function<void(int)>* task;
+		int size;
+		std::atomic<int> next;
+		// workers inside a task of the job, guarded by mutex
+		int nrunning;
+		// the first exception a task threw, guarded by mutex
+		std::exception_ptr error;
+	};
+	void WorkerLoop(void);
+	Job* OpenJob(void) const;
+	bool RunTask(Job & job);
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable jobready;
+	std::condition_variable jobdone;
+	std::vector<Job*> jobs;
+	bool stopping;
+};
+
+template <typename Index, typename Task>
+void ThreadPool::ParallelBlocks(Index n, bool parallel, const Task & task)
+{
+	const Index size = blocksize;
+	const int nblocks = static_cast<int>((n + size - 1) / size);
+	auto block = [&](int b)
+	{
+		const Index begin = b * size;
+		task(b, begin, n - begin > size ? begin + size : n);
+	};
+	if (parallel)
+	{
+		ParallelFor(nblocks, block);
+	}
+	else
+	{
+		for (int b = 0; b < nblocks; ++b) block(b);
+	}
+}
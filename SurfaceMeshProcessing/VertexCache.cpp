@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cmath>
+#include "VertexCache.h"
+#include "ThreadPool.h"
+
+// Measure takes the size by reference
+const int VertexCache::maxcachesize;
+
+bool VertexCache::Optimize(std::vector<unsigned int> & indices, const int & nvertices, const std::atomic<bool>* cancelled)
+{
+	const int ntriangles = static_cast<int>(indices.size() / 3);
+	if (ntriangles == 0) return true;
+
+	// the triangles of every vertex; the remaining[v] that are not emitted
+	//   yet are kept at the front of its list
+	std::vector<int> offset(nvertices + 1, 0);
+	for (unsigned int v : indices) ++offset[v + 1];
+	for (int v = 0; v < nvertices; ++v) offset[v + 1] += offset[v];
+	std::vector<int> vertextriangles(indices.size());
+	std::vector<int> remaining(nvertices, 0);
+	for (int t = 0; t < ntriangles; ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			int v = indices[3 * t + k];
+			vertextriangles[offset[v] + remaining[v]++] = t;
+		}
+	}
+
+	// the scores of the common cases, by cache position + 1 and remaining
+	const int maxvalence = 32;
+	float table[maxcachesize + 1][maxvalence + 1];
+	for (int p = 0; p <= maxcachesize; ++p)
+	{
+		for (int r = 0; r <= maxvalence; ++r) table[p][r] = VertexScore(p - 1, r);
+	}
+	auto score = [&](int p, int r)
+	{
+		return r <= maxvalence ? table[p + 1][r] : VertexScore(p, r);
+	};
+	std::vector<int> position(nvertices, -1);
+	std::vector<float> vertexscore(nvertices);
+	for (int v = 0; v < nvertices; ++v) vertexscore[v] = score(-1, remaining[v]);
+
+	std::vector<char> emitted(ntriangles, 0);
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	int cache[maxcachesize + 3], newcache[maxcachesize + 3];
+	int cachesize = 0;
+	int cursor = 0;
+	int best = -1;
+	for (int n = 0; n < ntriangles; ++n)
+	{
+		if ((n & 0xffff) == 0 && cancelled && *cancelled) return false;
+		if (best < 0)
+		{
+			// no cached vertex has triangles left, so start again from the
+			//   first triangle in the input order that is not emitted
+			while (emitted[cursor]) ++cursor;
+			best = cursor;
+		}
+		const unsigned int* triangle = &indices[3 * best];
+		emitted[best] = 1;
+		result.insert(result.end(), triangle, triangle + 3);
+
+		// the vertices of the triangle move to the front of the cache
+		int newsize = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			int v = triangle[k];
+			newcache[newsize++] = v;
+			int* list = &vertextriangles[offset[v]];
+			*std::find(list, list + remaining[v], best) = list[remaining[v] - 1];
+			--remaining[v];
+		}
+		for (int i = 0; i < cachesize; ++i)
+		{
+			int v = cache[i];
+			if (v != static_cast<int>(triangle[0]) && v != static_cast<int>(triangle[1]) && v != static_cast<int>(triangle[2]))
+			{
+				newcache[newsize++] = v;
+			}
+		}
+		for (int i = maxcachesize; i < newsize; ++i)
+		{
+			int v = newcache[i];
+			position[v] = -1;
+			vertexscore[v] = score(-1, remaining[v]);
+		}
+		cachesize = std::min(newsize, static_cast<int>(maxcachesize));
+		for (int i = 0; i < cachesize; ++i)
+		{
+			int v = newcache[i];
+			cache[i] = v;
+			position[v] = i;
+			vertexscore[v] = score(i, remaining[v]);
+		}
+
+		// only the triangles of cached vertices changed their score, and the
+		//   best of them comes next
+		best = -1;
+		float bestscore = 0.0f;
+		for (int i = 0; i < cachesize; ++i)
+		{
+			int v = cache[i];
+			const int* list = &vertextriangles[offset[v]];
+			for (int j = 0; j < remaining[v]; ++j)
+			{
+				const unsigned int* t = &indices[3 * list[j]];
+				float s = vertexscore[t[0]] + vertexscore[t[1]] + vertexscore[t[2]];
+				if (s > bestscore)
+				{
+					best = list[j];
+					bestscore = s;
+				}
+			}
+		}
+	}
+	indices.swap(result);
+	return true;
+}
+
+bool VertexCache::OptimizeClusters(std::vector<unsigned int> & indices, const int & clustersize, const std::atomic<bool>* cancelled)
+{
+	const int ntriangles = static_cast<int>(indices.size() / 3);
+	const int nclusters = (ntriangles + clustersize - 1) / clustersize;
+	std::vector<unsigned int> result(indices.size());
+	std::atomic<bool> stopped(false);
+	ThreadPool::Global().ParallelFor(nclusters, [&](int c)
+	{
+		if (stopped) return;
+		// the vertices of the run numbered from 0
+		const size_t begin = 3 * static_cast<size_t>(c) * clustersize;
+		const size_t end = std::min(indices.size(), begin + 3 * static_cast<size_t>(clustersize));
+		std::vector<unsigned int> vertices(indices.begin() + begin, indices.begin() + end);
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+		std::vector<unsigned int> local(end - begin);
+		for (size_t i = begin; i < end; ++i)
+		{
+			local[i - begin] = static_cast<unsigned int>(std::lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+		}
+		if (!Optimize(local, static_cast<int>(vertices.size()), cancelled))
+		{
+			stopped = true;
+			return;
+		}
+		for (size_t i = begin; i < end; ++i)
+		{
+			result[i] = vertices[local[i - begin]];
+		}
+	});
+	if (stopped || (cancelled && *cancelled)) return false;
+	indices.swap(result);
+	return true;
+}
+
+void VertexCache::Measure(const std::vector<unsigned int> & indices, const int & nvertices, const int & cachesize, double & acmr, double & atvr)
+{
+	// a vertex is in the FIFO cache until cachesize misses came after its own
+	std::vector<long long> missed(nvertices, -1);
+	long long misses = 0;
+	long long used = 0;
+	for (unsigned int v : indices)
+	{
+		if (missed[v] >= 0 && misses - missed[v] < cachesize) continue;
+		if (missed[v] < 0) ++used;
+		missed[v] = misses++;
+	}
+	const size_t ntriangles = indices.size() / 3;
+	acmr = ntriangles ? static_cast<double>(misses) / ntriangles : 0.0;
+	atvr = used ? static_cast<double>(misses) / used : 0.0;
+}
+
+float VertexCache::VertexScore(int cacheposition, int remaining)
+{
+	// Forsyth's constants
+	const float cachedecaypower = 1.5f;
+	const float lasttrianglescore = 0.75f;
+	const float valenceboostscale = 2.0f;
+	const float valenceboostpower = 0.5f;
+	if (remaining == 0) return -1.0f;
+	float score = 0.0f;
+	if (cacheposition >= 0)
+	{
+		if (cacheposition < 3)
+		{
+			// the vertices of the last triangle get a fixed, lower score, so
+			//   that the next triangle does not just reuse its edge
+			score = lasttrianglescore;
+		}
+		else
+		{
+			const float scaler = 1.0f / (maxcachesize - 3);
+			score = std::pow(1.0f - (cacheposition - 3) * scaler, cachedecaypower);
+		}
+	}
+	// vertices with few triangles left are taken first, so that they leave
+	//   the cache and no lone triangles stay behind
+	score += valenceboostscale * std::pow(static_cast<float>(remaining), -valenceboostpower);
+	return score;
+}
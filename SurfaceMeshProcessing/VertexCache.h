@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+// Triangle order for the post-transform vertex cache of the GPU: a vertex
+//   still in the cache from an earlier triangle of an indexed draw is not
+//   shaded again. The face order of a loaded mesh is whatever the exporter
+//   chose, and often misses the cache on most vertices.
+class VertexCache
+{
+public:
+	// Reorders the triangles of a list of vertex index triples with Forsyth's
+	//   "Linear-speed vertex cache optimisation" (2006), which greedily emits
+	//   the triangle whose vertices score highest in a simulated LRU cache.
+	//   The result depends on no particular cache size. Returns false and
+	//   leaves indices unchanged if cancelled is set while it runs.
+	static bool Optimize(std::vector<unsigned int> & indices, const int & nvertices, const std::atomic<bool>* cancelled = nullptr);
+	// Optimize on every run of clustersize triangles by itself, in parallel,
+	//   so that each triangle stays in its run (see MeshClusters).
+	static bool OptimizeClusters(std::vector<unsigned int> & indices, const int & clustersize, const std::atomic<bool>* cancelled = nullptr);
+	// Simulates a FIFO cache of cachesize entries. acmr is the average number
+	//   of misses per triangle, 0.5 at best on large closed meshes and 3 at
+	//   worst; atvr is the number of misses per vertex used, 1 at best.
+	static void Measure(const std::vector<unsigned int> & indices, const int & nvertices, const int & cachesize, double & acmr, double & atvr);
+
+	// size of the cache Optimize simulates
+	static const int maxcachesize = 32;
+private:
+	static float VertexScore(int cacheposition, int remaining);
+};
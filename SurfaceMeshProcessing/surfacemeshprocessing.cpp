@@ -42,6 +42,21 @@ void SurfaceMeshProcessing::CreateActions(void)
 	actScreenshot->setStatusTip(tr("Save Screenshot"));
 	connect(actScreenshot, SIGNAL(triggered()), viewer, SLOT(Screenshot()));
 
+	actCacheMeshes = new QAction("Cache Loaded Meshes", this);
+	actCacheMeshes->setStatusTip(tr("Keep a binary .smc copy next to every loaded mesh for faster reloads"));
+	actCacheMeshes->setCheckable(true);
+	connect(actCacheMeshes, SIGNAL(toggled(bool)), viewer, SLOT(CacheMeshes(bool)));
+
+	actUndo = new QAction(tr("&Undo"), this);
+	actUndo->setShortcut(QKeySequence::Undo);
+	actUndo->setStatusTip(tr("Undo the last edit of the mesh"));
+	connect(actUndo, SIGNAL(triggered()), viewer, SLOT(Undo()));
+
+	actRedo = new QAction(tr("&Redo"), this);
+	actRedo->setShortcut(QKeySequence::Redo);
+	actRedo->setStatusTip(tr("Redo the last undone edit of the mesh"));
+	connect(actRedo, SIGNAL(triggered()), viewer, SLOT(Redo()));
+
 	actExit = new QAction(tr("E&xit"), this);
 	actExit->setShortcut(QKeySequence::Quit);
 	actExit->setStatusTip(tr("Exit the application"));
@@ -144,9 +159,14 @@ void SurfaceMeshProcessing::CreateMenus(void)
 	menuFile->addAction(actClearMesh);
 	menuFile->addSeparator()->setEnabled(false);
 	menuFile->addAction(actScreenshot);
+	menuFile->addAction(actCacheMeshes);
 	menuFile->addSeparator()->setEnabled(false);
 	menuFile->addAction(actExit);
 
+	QMenu *menuEdit = menuBar()->addMenu(tr("&Edit"));
+	menuEdit->addAction(actUndo);
+	menuEdit->addAction(actRedo);
+
 	QMenu *menuView = menuBar()->addMenu(tr("&View"));
 	QMenu *menuRenderMode = menuView->addMenu(tr("Render Mode"));
 	menuRenderMode->addAction(actPoints);
@@ -198,6 +218,14 @@ void SurfaceMeshProcessing::CreateToolBars(void)
 void SurfaceMeshProcessing::CreateStatusBar(void)
 {
 	connect(viewer, SIGNAL(haveLoadMesh(QString)), statusBar(), SLOT(showMessage(QString)));
+	connect(viewer, SIGNAL(loadMeshProgress(QString)), statusBar(), SLOT(showMessage(QString)));
+
+	QPushButton *btnCancelLoad = new QPushButton(tr("Cancel"), this);
+	btnCancelLoad->setStatusTip(tr("Cancel loading the mesh"));
+	btnCancelLoad->setVisible(false);
+	statusBar()->addPermanentWidget(btnCancelLoad);
+	connect(btnCancelLoad, SIGNAL(clicked()), viewer, SLOT(CancelLoad()));
+	connect(viewer, SIGNAL(loadMeshRunning(bool)), btnCancelLoad, SLOT(setVisible(bool)));
 }
 
 void SurfaceMeshProcessing::About(void)
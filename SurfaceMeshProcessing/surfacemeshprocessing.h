@@ -27,6 +27,9 @@ private:
 	QAction *actSave;
 	QAction *actClearMesh;
 	QAction *actScreenshot;
+	QAction *actCacheMeshes;
+	QAction *actUndo;
+	QAction *actRedo;
 	QAction *actExit;
 
 	// View Actions.
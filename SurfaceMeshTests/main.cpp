@@ -0,0 +1,335 @@
+#include <iostream>
+#include <algorithm>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <vector>
+#include "MeshDefinition.h"
+#include "MeshBuilder.h"
+#include "MeshGenerator.h"
+
+// Checks that MeshBuilder::Build gives the mesh add_face gives: the same
+//   vertex, edge and face indices, linked the same way, including the
+//   outgoing halfedge of every vertex, for polygons, boundaries, non-manifold
+//   vertices, faces in any order and the input Build hands over to the per
+//   face path. Prints one line per case and exits non-zero if any fails.
+
+namespace
+{
+	// a polygon index buffer as MeshBuilder takes it
+	struct Input
+	{
+		std::vector<Mesh::Point> points;
+		std::vector<int> faceindices;
+		std::vector<int> faceoffsets = std::vector<int>(1, 0);
+		void AddFace(std::initializer_list<int> face)
+		{
+			faceindices.insert(faceindices.end(), face.begin(), face.end());
+			faceoffsets.push_back(static_cast<int>(faceindices.size()));
+		}
+	};
+
+	Input Points(int n)
+	{
+		Input input;
+		for (int i = 0; i < n; ++i)
+		{
+			input.points.push_back(Mesh::Point(Mesh::Scalar(i), Mesh::Scalar(i % 3), Mesh::Scalar(i % 5)));
+		}
+		return input;
+	}
+
+	Input FromMesh(const Mesh & mesh)
+	{
+		Input input;
+		input.points.assign(mesh.points(), mesh.points() + mesh.n_vertices());
+		for (const auto & fh : mesh.faces())
+		{
+			for (const auto & fvh : mesh.fv_range(fh))
+			{
+				input.faceindices.push_back(fvh.idx());
+			}
+			input.faceoffsets.push_back(static_cast<int>(input.faceindices.size()));
+		}
+		return input;
+	}
+
+	// the grid's triangles come in pairs (v0, v1, v2), (v0, v2, v3), the fan
+	//   of the quad (v0, v1, v2, v3)
+	Input Quads(const Mesh & grid)
+	{
+		Input input;
+		input.points.assign(grid.points(), grid.points() + grid.n_vertices());
+		for (int f = 0; f + 1 < static_cast<int>(grid.n_faces()); f += 2)
+		{
+			for (const auto & fvh : grid.fv_range(Mesh::FaceHandle(f)))
+			{
+				input.faceindices.push_back(fvh.idx());
+			}
+			int v0 = input.faceindices[input.faceindices.size() - 3], v2 = input.faceindices.back();
+			for (const auto & fvh : grid.fv_range(Mesh::FaceHandle(f + 1)))
+			{
+				if (fvh.idx() != v0 && fvh.idx() != v2) input.faceindices.push_back(fvh.idx());
+			}
+			input.faceoffsets.push_back(static_cast<int>(input.faceindices.size()));
+		}
+		return input;
+	}
+
+	Input Shuffled(const Input & input, unsigned int seed)
+	{
+		std::vector<int> order(input.faceoffsets.size() - 1);
+		for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+		std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+		Input shuffled;
+		shuffled.points = input.points;
+		for (int f : order)
+		{
+			shuffled.faceindices.insert(shuffled.faceindices.end(),
+				input.faceindices.begin() + input.faceoffsets[f], input.faceindices.begin() + input.faceoffsets[f + 1]);
+			shuffled.faceoffsets.push_back(static_cast<int>(shuffled.faceindices.size()));
+		}
+		return shuffled;
+	}
+
+	// add_face called directly, for input without repeated or out of range
+	//   indices
+	void AddFaces(Mesh & mesh, const Input & input)
+	{
+		for (const auto & p : input.points)
+		{
+			mesh.add_vertex(p);
+		}
+		std::vector<Mesh::VertexHandle> face;
+		for (size_t i = 0; i + 1 < input.faceoffsets.size(); ++i)
+		{
+			face.clear();
+			for (int j = input.faceoffsets[i]; j < input.faceoffsets[i + 1]; ++j)
+			{
+				face.push_back(Mesh::VertexHandle(input.faceindices[j]));
+			}
+			mesh.add_face(face);
+		}
+	}
+
+	// the same vertices, halfedges and faces, linked the same way
+	bool SameConnectivity(const Mesh & a, const Mesh & b, std::string & difference)
+	{
+		if (a.n_vertices() != b.n_vertices() || a.n_edges() != b.n_edges() || a.n_faces() != b.n_faces())
+		{
+			difference = std::to_string(a.n_vertices()) + "/" + std::to_string(a.n_edges()) + "/" + std::to_string(a.n_faces()) + " against "
+				+ std::to_string(b.n_vertices()) + "/" + std::to_string(b.n_edges()) + "/" + std::to_string(b.n_faces()) + " vertices/edges/faces";
+			return false;
+		}
+		for (const auto & vh : a.vertices())
+		{
+			if (a.point(vh) != b.point(vh))
+			{
+				difference = "point of vertex " + std::to_string(vh.idx());
+				return false;
+			}
+			if (a.halfedge_handle(vh) != b.halfedge_handle(vh))
+			{
+				difference = "outgoing halfedge of vertex " + std::to_string(vh.idx());
+				return false;
+			}
+		}
+		for (const auto & heh : a.halfedges())
+		{
+			if (a.to_vertex_handle(heh) != b.to_vertex_handle(heh) || a.next_halfedge_handle(heh) != b.next_halfedge_handle(heh)
+				|| a.face_handle(heh) != b.face_handle(heh))
+			{
+				difference = "halfedge " + std::to_string(heh.idx());
+				return false;
+			}
+		}
+		for (const auto & fh : a.faces())
+		{
+			if (a.halfedge_handle(fh) != b.halfedge_handle(fh))
+			{
+				difference = "halfedge of face " + std::to_string(fh.idx());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int nfailed = 0;
+
+	void Report(const std::string & name, bool ok, const std::string & difference)
+	{
+		if (ok)
+		{
+			std::cout << "ok      " << name << std::endl;
+		}
+		else
+		{
+			++nfailed;
+			std::cout << "FAILED  " << name << ": " << difference << std::endl;
+		}
+	}
+
+	// Build against BuildSequential, and against add_face called here when
+	//   the input is clean; nfaces is the number of faces add_face keeps, or
+	//   -1 to leave it unchecked
+	void Check(const std::string & name, const Input & input, bool clean, int nfaces = -1)
+	{
+		Mesh built, sequential;
+		std::string difference;
+		bool ok = MeshBuilder::Build(built, input.points, input.faceindices, input.faceoffsets)
+			&& MeshBuilder::BuildSequential(sequential, input.points, input.faceindices, input.faceoffsets);
+		if (!ok) difference = "returned false";
+		ok = ok && SameConnectivity(built, sequential, difference);
+		if (ok && clean)
+		{
+			Mesh added;
+			AddFaces(added, input);
+			ok = SameConnectivity(built, added, difference);
+		}
+		if (ok && nfaces >= 0 && static_cast<int>(built.n_faces()) != nfaces)
+		{
+			ok = false;
+			difference = std::to_string(built.n_faces()) + " faces, expected " + std::to_string(nfaces);
+		}
+		Report(name, ok, difference);
+	}
+}
+
+int main(void)
+{
+	{
+		Input input = Points(3);
+		input.AddFace({ 0, 1, 2 });
+		Check("triangle", input, true, 1);
+	}
+	{
+		// a quad and two pentagons in a strip, split into fans
+		Input input = Points(10);
+		input.AddFace({ 0, 1, 6, 5 });
+		input.AddFace({ 1, 2, 3, 7, 6 });
+		input.AddFace({ 3, 4, 9, 8, 7 });
+		Check("polygons", input, true, 8);
+	}
+	{
+		Mesh grid, quads;
+		MeshGenerator::Grid(grid, 2000);
+		Input input = Quads(grid);
+		Check("quad grid", input, true);
+		std::string difference;
+		bool ok = MeshBuilder::Build(quads, input.points, input.faceindices, input.faceoffsets)
+			&& SameConnectivity(quads, grid, difference);
+		Report("quad grid against its triangles", ok, difference);
+	}
+	{
+		Mesh mesh;
+		MeshGenerator::Icosphere(mesh, 2000);
+		Check("closed", FromMesh(mesh), true);
+		Check("closed, faces shuffled", Shuffled(FromMesh(mesh), 1), true);
+	}
+	{
+		Mesh mesh;
+		MeshGenerator::Torus(mesh, 5000);
+		Check("torus, faces shuffled", Shuffled(FromMesh(mesh), 2), true);
+	}
+	{
+		Mesh mesh;
+		MeshGenerator::HoleSurface(mesh, 3, 5000);
+		Check("boundaries", FromMesh(mesh), true);
+		Check("boundaries, faces shuffled", Shuffled(FromMesh(mesh), 3), true);
+	}
+	{
+		// the boundary vertices keep a boundary halfedge as the outgoing one
+		Mesh mesh;
+		MeshGenerator::Grid(mesh, 2000);
+		Check("grid, faces shuffled", Shuffled(FromMesh(mesh), 4), true);
+	}
+	{
+		Input input = Points(5);
+		input.AddFace({ 0, 1, 2 });
+		input.AddFace({ 0, 3, 4 });
+		Check("bowtie", input, true, 2);
+		// the gap between the two wings closed later
+		input.AddFace({ 0, 2, 3 });
+		Check("bowtie, gap filled", input, true, 3);
+	}
+	{
+		// a fan around vertex 0 filled in an order that leaves several gaps
+		Input input = Points(9);
+		for (int i : { 0, 4, 2, 6, 1, 7, 3, 5 })
+		{
+			input.AddFace({ 0, 1 + i, 1 + (i + 1) % 8 });
+		}
+		Check("fan, gaps filled", input, true, 8);
+	}
+	{
+		// points no face uses keep no halfedge
+		Input input = Points(6);
+		input.AddFace({ 1, 3, 5 });
+		Check("isolated vertices", input, true, 1);
+	}
+	{
+		// add_face refuses the second use of the oriented edge 0 -> 1; Build
+		//   hands the input to the per face path
+		Input input = Points(5);
+		input.AddFace({ 0, 1, 2 });
+		input.AddFace({ 1, 0, 3 });
+		input.AddFace({ 0, 1, 4 });
+		Check("edge used twice", input, true, 2);
+	}
+	{
+		// vertex 0 is inside a closed fan when the last face reaches it
+		Input input = Points(7);
+		input.AddFace({ 0, 1, 2 });
+		input.AddFace({ 0, 2, 3 });
+		input.AddFace({ 0, 3, 4 });
+		input.AddFace({ 0, 4, 1 });
+		input.AddFace({ 0, 5, 6 });
+		Check("face on a closed fan", input, true, 4);
+	}
+	{
+		// a repeated vertex is dropped, and faces left with fewer than three
+		//   vertices or with out of range indices are skipped
+		Input input = Points(4);
+		input.AddFace({ 0, 1, 1, 2 });
+		input.AddFace({ 0, 2 });
+		input.AddFace({ 2, 1, 7 });
+		input.AddFace({ 3, 3, 3 });
+		input.AddFace({ 0, 2, 3, 0 });
+		Check("repeated and out of range indices", input, false, 2);
+	}
+	{
+		// random triangles on a few vertices: non-manifold vertices, gaps
+		//   relinked or refused, and edges used twice
+		std::mt19937 random(5);
+		std::uniform_int_distribution<int> vertex(0, 7);
+		int nok = 0;
+		std::string difference;
+		for (int i = 0; i < 2000; ++i)
+		{
+			Input input = Points(8);
+			for (int f = 0; f < 10; ++f)
+			{
+				int a = vertex(random), b = vertex(random), c = vertex(random);
+				if (a != b && b != c && c != a) input.AddFace({ a, b, c });
+			}
+			Mesh built, sequential, added;
+			MeshBuilder::Build(built, input.points, input.faceindices, input.faceoffsets);
+			MeshBuilder::BuildSequential(sequential, input.points, input.faceindices, input.faceoffsets);
+			AddFaces(added, input);
+			if (SameConnectivity(built, sequential, difference) && SameConnectivity(built, added, difference)) ++nok;
+		}
+		Report("random triangles", nok == 2000, std::to_string(2000 - nok) + " of 2000 differ, the last in " + difference);
+	}
+	{
+		Mesh mesh, built;
+		MeshGenerator::Torus(mesh, 5000);
+		Input input = FromMesh(mesh);
+		LoadProgress progress;
+		progress.cancelled = true;
+		bool ok = !MeshBuilder::Build(built, input.points, input.faceindices, input.faceoffsets, &progress);
+		Report("cancelled", ok, "returned true");
+	}
+
+	if (nfailed > 0) std::cout << nfailed << " failed" << std::endl;
+	return nfailed == 0 ? 0 : 1;
+}